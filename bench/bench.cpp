@@ -0,0 +1,530 @@
+// Micro and end-to-end benchmarks for the software renderer.
+//
+// Every result is printed as a table on stderr and as one JSON document on stdout (or --json file),
+// so runs from different commits can be diffed or plotted. Give each run a --label (the commit hash, say).
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <numbers>
+#include <random>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <meshcache.h>
+#include <renderer.h>
+#include <streaming.h>
+#include <weld.h>
+#include <wireframe.h>
+
+namespace
+{
+	constexpr int width = 800;
+	constexpr int height = 800;
+
+	struct BenchOptions
+	{
+		std::string label = "";
+		std::string json = ""; // Empty = stdout
+		std::string filter = ""; // Only run benchmarks whose name contains this
+		unsigned threads = defaultThreadCount();
+		long long maxTriangles = 10'000'000;
+		double minSeconds = 0.25; // Each micro-benchmark repeats until it ran at least this long
+		int repeats = 3; // End-to-end scenes keep the fastest of this many frames
+	};
+
+	struct MicroResult
+	{
+		std::string name;
+		std::uint64_t iterations;
+		double nsPerOp;
+		double itemsPerOp; // Pixels, bytes, vertices... whatever the op processes, 0 if not meaningful
+		std::string unit;
+	};
+
+	struct SceneResult
+	{
+		std::string name;
+		int triangles;
+		int vertices;
+		double transformMs;
+		double rasterMs;
+		double encodeMs;
+		double totalMs;
+		std::uint64_t hiZTriangles;
+	};
+
+	// Keeps the compiler from dropping a computation whose result is never used
+	template<typename T>
+	void doNotOptimize(const T& value)
+	{
+#if defined(_MSC_VER)
+		const volatile char* p = reinterpret_cast<const volatile char*>(&value);
+		(void)*p;
+		_ReadWriteBarrier();
+#else
+		asm volatile("" : : "r,m"(value) : "memory");
+#endif
+	}
+
+	double secondsSince(const std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Doubles the batch size until one batch takes minSeconds, then reports the time per call of fn()
+	template<typename F>
+	MicroResult measure(const std::string& name, const BenchOptions& options, const double itemsPerOp, const std::string& unit, F&& fn)
+	{
+		fn(); // Warm caches and lazily initialized state
+		std::uint64_t iterations = 1;
+		double elapsed = 0;
+		for (;;)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			for (std::uint64_t i = 0; i < iterations; i++) fn();
+			elapsed = secondsSince(start);
+			if (elapsed >= options.minSeconds || iterations >= (1ull << 40)) break;
+			iterations *= elapsed > 0 ? std::clamp<std::uint64_t>(static_cast<std::uint64_t>(options.minSeconds / elapsed * 1.2), 2, 100) : 100;
+		}
+		return { name, iterations, elapsed * 1e9 / iterations, itemsPerOp, unit };
+	}
+
+	// UV sphere with about `target` triangles, centered on the origin like the usual OBJ models
+	Model makeSphere(const long long target)
+	{
+		const int rings = std::max(3, static_cast<int>(std::sqrt(target / 4.0)));
+		const int segments = 2 * rings;
+		constexpr float radius = 0.8f;
+
+		std::vector<float> positions;
+		positions.reserve(static_cast<size_t>(rings + 1) * segments * 3);
+		for (int r = 0; r <= rings; r++)
+		{
+			const double theta = std::numbers::pi * r / rings;
+			for (int s = 0; s < segments; s++)
+			{
+				const double phi = 2 * std::numbers::pi * s / segments;
+				positions.push_back(static_cast<float>(radius * std::sin(theta) * std::cos(phi)));
+				positions.push_back(static_cast<float>(radius * std::cos(theta)));
+				positions.push_back(static_cast<float>(radius * std::sin(theta) * std::sin(phi)));
+			}
+		}
+
+		// Counter-clockwise seen from outside, the poles get one degenerate triangle per segment which is fine for timing
+		std::vector<std::uint32_t> indices;
+		indices.reserve(static_cast<size_t>(rings) * segments * 6);
+		for (int r = 0; r < rings; r++)
+		{
+			for (int s = 0; s < segments; s++)
+			{
+				const std::uint32_t a = r * segments + s, b = r * segments + (s + 1) % segments;
+				const std::uint32_t c = a + segments, d = b + segments;
+				indices.insert(indices.end(), { a, b, c, b, d, c });
+			}
+		}
+		return Model(std::move(positions), std::move(indices));
+	}
+
+	std::string sceneName(const long long triangles)
+	{
+		if (triangles >= 1'000'000) return "sphere_" + std::to_string(triangles / 1'000'000) + "m";
+		if (triangles >= 1'000) return "sphere_" + std::to_string(triangles / 1'000) + "k";
+		return "sphere_" + std::to_string(triangles);
+	}
+
+	bool selected(const BenchOptions& options, const std::string& name)
+	{
+		return options.filter.empty() || name.find(options.filter) != std::string::npos;
+	}
+
+	void runMicro(const BenchOptions& options, std::vector<MicroResult>& results)
+	{
+		auto add = [&](const std::string& name, const double itemsPerOp, const std::string& unit, auto&& fn)
+		{
+			if (!selected(options, name)) return;
+			results.push_back(measure(name, options, itemsPerOp, unit, fn));
+			const MicroResult& r = results.back();
+			std::cerr << "  " << r.name << ": " << r.nsPerOp << " ns/op";
+			if (r.itemsPerOp > 0) std::cerr << ", " << r.itemsPerOp * 1e3 / r.nsPerOp << " M" << r.unit << "/s";
+			std::cerr << "\n";
+		};
+
+		FrameBuffer frameBuffer(width, height);
+
+		// line(): a short edge like most mesh edges, and a long diagonal
+		add("line_short", 10, "pixels", [&] { line(100, 100, 110, 104, frameBuffer, red); });
+		add("line_long", 700, "pixels", [&] { line(50, 60, 750, 700, frameBuffer, red); });
+
+		// triangle(): z grows every call so the depth test always passes and Hi-Z never rejects the triangle.
+		// The _subpixel variants take the same triangle in 28.4 fixed point, with the top-left fill rule.
+		for (const RasterMode mode : { RasterMode::Scalar, RasterMode::Simd })
+		{
+			for (const bool subpixel : { false, true })
+			{
+				const std::string suffix = std::string(mode == RasterMode::Scalar ? "_scalar" : "_simd") + (subpixel ? "_subpixel" : "");
+				const int scale = subpixel ? 1 << subpixelBits : 1;
+				for (const int size : { 8, 64, 512 })
+				{
+					DepthBuffer depth(width, height);
+					RasterOptions rasterOptions;
+					rasterOptions.mode = mode;
+					rasterOptions.subpixel = subpixel;
+					RasterStats stats;
+					const Tile whole = { 0, 0, width - 1, height - 1 };
+					double z = -1;
+					add("triangle_" + std::to_string(size) + suffix, size * size / 2.0, "pixels", [&]
+					{
+						z += 1e-6;
+						if (z > 1)
+						{
+							z = -1;
+							depth.clear();
+						}
+						triangle({ 100 * scale, 100 * scale, z }, { (100 + size) * scale, 100 * scale, z }, { 100 * scale, (100 + size) * scale, z }, green, whole, depth, frameBuffer, rasterOptions, stats);
+					});
+				}
+			}
+		}
+
+		// Textured triangle(): a 1024x1024 checkerboard repeated 8 times across a 512 pixel triangle, so every pixel covers
+		// 16x16 texels. With mipmaps that is level 4, without them each pixel lands on a different cache line of level 0.
+		TGAImage checker(1024, 1024, TGAImage::RGB);
+		for (int y = 0; y < checker.height(); y++)
+		{
+			for (int x = 0; x < checker.width(); x++) checker.set(x, y, ((x / 8 + y / 8) & 1) ? white : blue);
+		}
+		const Texture texture(checker);
+		const Model one({ 0, 0, 0, 1, 0, 0, 0, 1, 0 }, { 0, 1, 2 }); // The shaders' model, corners below are given directly
+		for (const TextureFilter filter : { TextureFilter::Nearest, TextureFilter::Bilinear })
+		{
+			for (const bool mipmaps : { true, false })
+			{
+				DepthBuffer depth(width, height);
+				RasterOptions rasterOptions;
+				rasterOptions.filter = filter;
+				rasterOptions.mipmaps = mipmaps;
+				RasterStats stats;
+				const Tile whole = { 0, 0, width - 1, height - 1 };
+				const TextureShader shader(one, texture, filter, mipmaps);
+				const Varyings<2> uv[3] = { { 0, 0 }, { 8, 0 }, { 0, 8 } };
+				constexpr int size = 512;
+				double z = -1;
+				add(std::string("triangle_512_textured_") + (filter == TextureFilter::Nearest ? "nearest" : "bilinear") + (mipmaps ? "" : "_nomips"), size * size / 2.0, "pixels", [&]
+				{
+					z += 1e-6;
+					if (z > 1)
+					{
+						z = -1;
+						depth.clear();
+					}
+					triangle({ 100, 100, z }, { 100 + size, 100, z }, { 100, 100 + size, z }, shader, {}, uv, whole, depth, frameBuffer, rasterOptions, stats);
+				});
+			}
+		}
+
+		// The other shaders on the same 512 pixel triangle, corners from the one-face model (its normal faces the light)
+		auto shaded = [&](const std::string& name, const auto& shader)
+		{
+			using S = std::decay_t<decltype(shader)>;
+			DepthBuffer depth(width, height);
+			const RasterOptions rasterOptions;
+			RasterStats stats;
+			const Tile whole = { 0, 0, width - 1, height - 1 };
+			const Varyings<S::varyings> corners[3] = { shader.vertex(0, 0), shader.vertex(0, 1), shader.vertex(0, 2) };
+			constexpr int size = 512;
+			double z = -1;
+			add("triangle_512_" + name, size * size / 2.0, "pixels", [&]
+			{
+				z += 1e-6;
+				if (z > 1)
+				{
+					z = -1;
+					depth.clear();
+				}
+				triangle({ 100, 100, z }, { 100 + size, 100, z }, { 100, 100 + size, z }, shader, shader.face(0), corners, whole, depth, frameBuffer, rasterOptions, stats);
+			});
+		};
+		const vec3f light = normalized(vec3f{ 1, 1, 1 });
+		shaded("depth", DepthShader());
+		shaded("gouraud", GouraudShader(one, light));
+		shaded("phong", PhongShader<false>(one, light, vec3f{ 0, 0, 3 }));
+		shaded("normals", NormalShader(one));
+
+		// project(): the per-vertex reference path
+		const View view = makeView(Camera(), width, height);
+		const mat<4, 4> viewportProjectionModelView = view.transform();
+		vec4 point = { 0.3, -0.2, 0.1, 1 };
+		add("project", 1, "vertices", [&]
+		{
+			point.x += 1e-9;
+			doNotOptimize(project(view.viewport, view.perspective * view.modelView * point));
+		});
+
+		// geometry.h in double and single precision
+		vec3 a = { 0.1, 0.2, 0.3 }, b = { -0.4, 0.5, 0.6 };
+		vec3f af = tofloat(a), bf = tofloat(b);
+		vec4 v4 = { 0.1, 0.2, 0.3, 1 };
+		vec4f v4f = tofloat(v4);
+		const mat4f mf = tofloat(viewportProjectionModelView);
+		add("vec3_cross_normalized", 1, "ops", [&] { a = normalized(cross(a, b)); doNotOptimize(a); });
+		add("vec3f_cross_normalized", 1, "ops", [&] { af = normalized(cross(af, bf)); doNotOptimize(af); });
+		add("vec3_dot", 1, "ops", [&] { a.x += 1e-9; doNotOptimize(a * b); });
+		add("vec3f_dot", 1, "ops", [&] { af.x += 1e-9f; doNotOptimize(af * bf); });
+		add("mat4_mul_vec4", 1, "ops", [&] { v4.x += 1e-9; doNotOptimize(viewportProjectionModelView * v4); });
+		add("mat4f_mul_vec4f", 1, "ops", [&] { v4f.x += 1e-9f; doNotOptimize(mf * v4f); });
+		add("mat4_mul_mat4", 1, "ops", [&] { doNotOptimize(view.transform()); });
+		add("mat4f_mul_mat4f", 1, "ops", [&] { doNotOptimize(mf * mf); });
+
+		// Model loading: a generated OBJ, parsed from text and then mapped from its cache
+		const Model sphere = makeSphere(200'000);
+		const std::filesystem::path directory = std::filesystem::temp_directory_path();
+		const std::string objPath = (directory / "opengldemo_bench.obj").string();
+		{
+			std::ofstream out(objPath);
+			const PositionView p = sphere.positions();
+			for (size_t i = 0; i < p.size(); i++) out << "v " << p[i].x << ' ' << p[i].y << ' ' << p[i].z << '\n';
+			for (int i = 0; i < sphere.nfaces(); i++)
+			{
+				out << "f " << sphere.vertIndex(i, 0) + 1 << ' ' << sphere.vertIndex(i, 1) + 1 << ' ' << sphere.vertIndex(i, 2) + 1 << '\n';
+			}
+		}
+		const double objBytes = static_cast<double>(std::filesystem::file_size(objPath));
+		std::streambuf* log = std::cerr.rdbuf(nullptr); // The loader logs every load, which would drown the table
+		ModelLoadOptions parseOptions;
+		parseOptions.threads = options.threads;
+		parseOptions.cache = false;
+		parseOptions.order = MeshOrder::File; // The parser alone, vertex_cache_order below times the reordering
+		ModelLoadOptions cacheOptions = parseOptions;
+		cacheOptions.cache = true;
+		{
+			Model warm(objPath, cacheOptions); // Writes the cache for model_load_cached
+		}
+		std::cerr.rdbuf(log);
+		add("model_load_obj", objBytes, "bytes", [&]
+		{
+			log = std::cerr.rdbuf(nullptr);
+			Model model(objPath, parseOptions);
+			std::cerr.rdbuf(log);
+			doNotOptimize(model.nfaces());
+		});
+		add("model_load_cached", objBytes, "bytes", [&]
+		{
+			log = std::cerr.rdbuf(nullptr);
+			Model model(objPath, cacheOptions);
+			std::cerr.rdbuf(log);
+			doNotOptimize(model.nfaces());
+		});
+		{
+			// The same sphere drawn from its cache in 64k face chunks: reads, per-chunk clusters and rasterization
+			FrameBuffer frame(width, height);
+			DepthBuffer depth(width, height);
+			StreamOptions streamOptions;
+			streamOptions.chunkFaces = 1 << 16;
+			add("faces_streamed", sphere.nfaces(), "faces", [&]
+			{
+				depth.clear();
+				RasterStats stats;
+				StreamStats streamStats;
+				doNotOptimize(renderStreamed(objPath, view, { ShaderKind::Depth }, depth, frame, options.threads, {}, streamOptions, stats, streamStats));
+			});
+		}
+		std::filesystem::remove(objPath);
+		std::filesystem::remove(meshCachePath(objPath));
+
+		// write_tga_file() on a rendered frame, which has long runs like real output
+		FrameBuffer frame(width, height);
+		{
+			DepthBuffer depth(width, height);
+			ScreenVertices screen;
+			transformVertices(sphere.positions(), viewportProjectionModelView, width, height, screen, options.threads);
+			RasterStats stats;
+			const std::vector<TGAColor> colors = randomFaceColors(sphere.nfaces());
+			renderFaces(sphere, view, screen, { ShaderKind::Flat, colors }, depth, frame, options.threads, {}, stats);
+		}
+		const std::string tgaPath = (directory / "opengldemo_bench.tga").string();
+		const double frameBytes = static_cast<double>(width) * height * static_cast<int>(TGAImage::RGB);
+		add("write_tga_rle", frameBytes, "bytes", [&] { frame.write_tga_file(tgaPath, true); });
+		add("write_tga_raw", frameBytes, "bytes", [&] { frame.write_tga_file(tgaPath, false); });
+		std::filesystem::remove(tgaPath);
+
+		// Wireframe of the same sphere: the unique edge list, then one frame of it
+		add("wireframe_edges", sphere.nfaces(), "faces", [&] { doNotOptimize(buildEdges(sphere.indices(), sphere.nverts(), options.threads).size()); });
+		{
+			const EdgeList edges = buildEdges(sphere.indices(), sphere.nverts(), options.threads);
+			ScreenVertices screen;
+			transformVertices(sphere.positions(), viewportProjectionModelView, width, height, screen, options.threads);
+			add("wireframe_frame", edges.size(), "edges", [&] { renderWireframe(sphere, edges, screen, frame, options.threads); });
+		}
+
+		// Vertex cache reordering of the sphere's faces shuffled, the worst case input (ACMR close to 3)
+		{
+			std::vector<std::uint32_t> faces(sphere.nfaces()), shuffled(sphere.indices().size());
+			for (size_t i = 0; i < faces.size(); i++) faces[i] = static_cast<std::uint32_t>(i);
+			std::shuffle(faces.begin(), faces.end(), std::mt19937(1));
+			for (size_t i = 0; i < shuffled.size(); i++) shuffled[i] = sphere.indices()[faces[i / 3] * 3 + i % 3];
+			add("vertex_cache_order", sphere.nfaces(), "faces", [&] { doNotOptimize(optimizeFaceOrder(shuffled, sphere.nverts()).size()); });
+		}
+
+		// Welding the sphere stored as a triangle soup, every corner its own vertex (the copy is part of the time)
+		{
+			std::vector<float> soup(sphere.indices().size() * 3);
+			for (size_t i = 0; i < sphere.indices().size(); i++)
+			{
+				const vec3f p = sphere.positions()[sphere.indices()[i]];
+				soup[i * 3] = p.x;
+				soup[i * 3 + 1] = p.y;
+				soup[i * 3 + 2] = p.z;
+			}
+			add("weld_vertices", soup.size() / 3.0, "vertices", [&]
+			{
+				std::vector<float> positions = soup;
+				doNotOptimize(weldVertices(positions, 0).size());
+			});
+		}
+	}
+
+	void runScenes(const BenchOptions& options, std::vector<SceneResult>& results)
+	{
+		const View view = makeView(Camera(), width, height);
+		const mat<4, 4> viewportProjectionModelView = view.transform();
+		const std::string tgaPath = (std::filesystem::temp_directory_path() / "opengldemo_bench_scene.tga").string();
+
+		for (long long target = 1'000; target <= options.maxTriangles; target *= 10)
+		{
+			const std::string name = sceneName(target);
+			if (!selected(options, name)) continue;
+			const Model model = makeSphere(target);
+
+			SceneResult best = { name, model.nfaces(), model.nverts(), 0, 0, 0, 1e300, 0 };
+			for (int r = 0; r < options.repeats; r++)
+			{
+				srand(7);
+				FrameBuffer frameBuffer(width, height);
+				DepthBuffer zBuffer(width, height);
+				ScreenVertices screen;
+				RasterStats stats;
+
+				const auto start = std::chrono::steady_clock::now();
+				transformVertices(model.positions(), viewportProjectionModelView, width, height, screen, options.threads);
+				const double transform = secondsSince(start);
+				const std::vector<TGAColor> colors = randomFaceColors(model.nfaces());
+				renderFaces(model, view, screen, { ShaderKind::Flat, colors }, zBuffer, frameBuffer, options.threads, {}, stats);
+				const double raster = secondsSince(start) - transform;
+				frameBuffer.write_tga_file(tgaPath);
+				const double total = secondsSince(start);
+
+				if (total * 1e3 < best.totalMs)
+				{
+					best = { name, model.nfaces(), model.nverts(), transform * 1e3, raster * 1e3, (total - transform - raster) * 1e3, total * 1e3, stats.hiZTriangles };
+				}
+			}
+			std::cerr << "  " << best.name << " (" << best.triangles << " triangles): " << best.totalMs << " ms total, "
+				<< best.transformMs << " transform, " << best.rasterMs << " raster, " << best.encodeMs << " encode\n";
+			results.push_back(best);
+		}
+		std::filesystem::remove(tgaPath);
+	}
+
+	std::string quoted(const std::string& text)
+	{
+		std::string out = "\"";
+		for (const char c : text)
+		{
+			if (c == '"' || c == '\\') out += '\\';
+			out += c;
+		}
+		return out + "\"";
+	}
+
+	void writeJson(std::ostream& out, const BenchOptions& options, const std::vector<MicroResult>& micro, const std::vector<SceneResult>& scenes)
+	{
+		out.precision(6);
+		out << "{\n";
+		out << "  \"label\": " << quoted(options.label) << ",\n";
+		out << "  \"threads\": " << options.threads << ",\n";
+		out << "  \"simd\": " << quoted(simdRasterName()) << ",\n";
+		out << "  \"width\": " << width << ",\n";
+		out << "  \"height\": " << height << ",\n";
+		out << "  \"micro\": [";
+		for (size_t i = 0; i < micro.size(); i++)
+		{
+			const MicroResult& r = micro[i];
+			out << (i ? "," : "") << "\n    { \"name\": " << quoted(r.name) << ", \"iterations\": " << r.iterations << ", \"ns_per_op\": " << r.nsPerOp;
+			if (r.itemsPerOp > 0) out << ", \"unit\": " << quoted(r.unit) << ", \"items_per_second\": " << r.itemsPerOp * 1e9 / r.nsPerOp;
+			out << " }";
+		}
+		out << "\n  ],\n";
+		out << "  \"scenes\": [";
+		for (size_t i = 0; i < scenes.size(); i++)
+		{
+			const SceneResult& r = scenes[i];
+			out << (i ? "," : "") << "\n    { \"name\": " << quoted(r.name) << ", \"triangles\": " << r.triangles << ", \"vertices\": " << r.vertices
+				<< ", \"transform_ms\": " << r.transformMs << ", \"raster_ms\": " << r.rasterMs << ", \"encode_ms\": " << r.encodeMs
+				<< ", \"total_ms\": " << r.totalMs << ", \"hiz_triangles\": " << r.hiZTriangles << " }";
+		}
+		out << "\n  ]\n}\n";
+	}
+
+	void usage(const char* argv0)
+	{
+		std::cerr << "Usage: " << argv0 << " [--label TEXT] [--json FILE] [--filter TEXT] [--threads N] [--max-triangles N] [--min-time SECONDS] [--repeats N] [--micro-only] [--scenes-only]\n";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchOptions options;
+	bool micro = true, scenes = true;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string_view option(argv[i]);
+		if (option == "--label" && i + 1 < argc) options.label = argv[++i];
+		else if (option == "--json" && i + 1 < argc) options.json = argv[++i];
+		else if (option == "--filter" && i + 1 < argc) options.filter = argv[++i];
+		else if (option == "--threads" && i + 1 < argc) options.threads = std::max(1, std::atoi(argv[++i]));
+		else if (option == "--max-triangles" && i + 1 < argc) options.maxTriangles = std::atoll(argv[++i]);
+		else if (option == "--min-time" && i + 1 < argc) options.minSeconds = std::atof(argv[++i]);
+		else if (option == "--repeats" && i + 1 < argc) options.repeats = std::max(1, std::atoi(argv[++i]));
+		else if (option == "--micro-only") scenes = false;
+		else if (option == "--scenes-only") micro = false;
+		else
+		{
+			usage(argv[0]);
+			return option == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	std::vector<MicroResult> microResults;
+	std::vector<SceneResult> sceneResults;
+	if (micro)
+	{
+		std::cerr << "Micro-benchmarks (" << simdRasterName() << ", " << options.threads << " threads)\n";
+		runMicro(options, microResults);
+	}
+	if (scenes)
+	{
+		std::cerr << "Scenes up to " << options.maxTriangles << " triangles\n";
+		runScenes(options, sceneResults);
+	}
+
+	if (options.json.empty())
+	{
+		writeJson(std::cout, options, microResults, sceneResults);
+		return EXIT_SUCCESS;
+	}
+	std::ofstream out(options.json);
+	if (!out)
+	{
+		std::cerr << "Can't write " << options.json << "\n";
+		return EXIT_FAILURE;
+	}
+	writeJson(out, options, microResults, sceneResults);
+	return EXIT_SUCCESS;
+}
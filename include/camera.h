@@ -0,0 +1,33 @@
+#pragma once
+#include <numbers>
+#include <string>
+#include <vector>
+#include <geometry.h>
+
+struct Camera
+{
+	vec3 eye = { -1, 0, 2 }; // Camera position in 3D space
+	vec3 center = { 0, 0, 0 }; // Point the camera is looking at
+	vec3 up = { 0, 1, 0 }; // Up direction of the camera
+	double fov = std::numbers::pi / 4; // Field of view in radians
+};
+
+mat<4, 4> lookAt(const vec3 eye, const vec3 center, const vec3 up);
+mat<4, 4> perspective(const double f);
+mat<4, 4> viewport(const int x, const int y, const int w, const int h);
+
+// Everything that changes from one camera to the next. Each render gets its own, so several views can be drawn at once.
+struct View
+{
+	Camera camera = {};
+	mat<4, 4> modelView = {}, perspective = {}, viewport = {};
+
+	mat<4, 4> transform() const { return viewport * perspective * modelView; } // What transformVertices() applies
+};
+
+// The camera looking at a width x height framebuffer, with the usual 1/16 margin on every side
+View makeView(const Camera& camera, const int width, const int height);
+
+// Reads one camera per line: "eye.x eye.y eye.z center.x center.y center.z up.x up.y up.z fov", fov in degrees.
+// Blank lines and lines starting with '#' are skipped. Prints the offending line and returns false on bad input.
+bool loadCameras(const std::string& filename, std::vector<Camera>& cameras);
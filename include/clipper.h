@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <geometry.h>
+
+// Outcode bits, one per clip plane a vertex lies outside of. Planes are taken in the homogeneous screen space
+// produced by the combined Viewport * Perspective * ModelView matrix (before the divide), so x and y are
+// bounded by the framebuffer rather than by the viewport. A vertex is outside when its truncated pixel coordinate
+// is, x/w <= -1 or x/w >= width, so a triangle with all corners outside one plane covers no pixel at all.
+enum ClipBits : std::uint8_t
+{
+	ClipNear = 1, // w below clipNearW: at, behind or too close to the eye to divide by
+	ClipLeft = 2,
+	ClipRight = 4,
+	ClipBottom = 8,
+	ClipTop = 16,
+};
+
+constexpr float clipNearW = 1.0f / 64;
+
+inline std::uint8_t outcode(const vec4f& p, const float width, const float height)
+{
+	return (p.w < clipNearW ? ClipNear : 0) | (p.x <= -p.w ? ClipLeft : 0) | (p.x >= width * p.w ? ClipRight : 0)
+		| (p.y <= -p.w ? ClipBottom : 0) | (p.y >= height * p.w ? ClipTop : 0);
+}
+
+// Sutherland-Hodgman against the near plane in homogeneous space. Writes the convex polygon left in front
+// of the plane to `out`, in the input winding, and returns its vertex count (0, 3 or 4).
+int clipNear(const vec4f (&in)[3], vec4f (&out)[4]);
+
+// Same, also giving the weights of in[0], in[1] and in[2] in each output vertex. Attributes are linear in clip space
+// like the positions, so these weights give their values at the new vertices.
+int clipNear(const vec4f (&in)[3], vec4f (&out)[4], vec3f (&weights)[4]);
+
+// Same for a segment, false when it lies entirely behind the near plane
+bool clipNear(vec4f& a, vec4f& b);
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <geometry.h>
+#include <vertexformat.h>
+
+// A group of up to clusterSize nearby faces with similar normals, with a bounding sphere and a cone holding all of
+// their normals. Faces are grouped by normal direction and then in Morton order of their centers, but they keep their
+// ids: the renderer still walks faces in file order, clusters only decide which faces it can skip.
+// Plain floats and integers only, the array is stored as is in the mesh cache.
+struct Cluster
+{
+	float center[3] = {};
+	float radius = 0;
+	float axis[3] = {}; // Mean face normal, unit length
+	float coneSin = 1; // Sine of the cone half angle, >= 1 when the normals spread too wide for a backface test
+	std::uint32_t first = 0, count = 0; // Range of the cluster's face ids in ClusterSet::faces
+};
+static_assert(sizeof(Cluster) == 40, "clusters are read straight from the mesh cache");
+
+constexpr int clusterSize = 64; // Faces per cluster, the last cluster of each normal group may hold fewer
+
+struct ClusterSet
+{
+	std::vector<Cluster> clusters = {};
+	std::vector<std::uint32_t> faces = {}; // Every face id exactly once, ascending inside each cluster
+};
+
+ClusterSet buildClusters(const PositionView& positions, const IndexView& indices, const unsigned threads);
+
+// Clusters of consecutive faces instead, cut where the normal turns to another side like above. No sort, so a fraction
+// of the cost, and about as tight when the face order is already local (the vertex cache order). For short-lived meshes.
+ClusterSet buildSequentialClusters(const PositionView& positions, const IndexView& indices, const unsigned threads);
+
+enum class ClusterVisibility { Visible, Outside, Backfacing };
+
+// Whole-cluster versions of the per-face tests of the renderer: the same five clip planes the vertex outcodes use,
+// and isBackFacing() against the camera position. A cluster is only rejected when every face in it would be.
+class ClusterCuller
+{
+	vec4 planes[5] = {}; // Object space, a point p is inside when planes[i] * (p, 1) > 0
+	vec3 eye = {};
+
+public:
+	ClusterCuller(const mat4f& viewportProjectionModelView, const int width, const int height, const vec3f& eye);
+	ClusterVisibility test(const Cluster& cluster) const;
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include <limits>
+#include <vector>
+#include <tgaimage.h>
+
+// Float z-buffer, higher z is closer to the camera (same convention as the NDC z the projection produces).
+// Storage is one contiguous row-major float per pixel so the rasterizer can test and write whole pixel blocks.
+// On top of it sits a coarse Hi-Z level holding the farthest depth of every 8x8 block, which lets the
+// rasterizer throw away triangles or blocks that are certainly hidden before evaluating any pixel.
+class DepthBuffer
+{
+	int w = 0, h = 0;
+	int bw = 0, bh = 0; // Size of the Hi-Z level in blocks
+	std::vector<float> depth = {};
+	std::vector<float> blockFar = {}; // Farthest depth stored in each block
+
+public:
+	static constexpr float farthest = -std::numeric_limits<float>::infinity(); // Value of pixels nothing was drawn to
+	static constexpr int blockSize = 8; // Side of a Hi-Z block in pixels, tiles must be a multiple of it
+
+	DepthBuffer(const int w, const int h);
+	int width() const { return w; }
+	int height() const { return h; }
+	void clear();
+
+	// Unchecked accessors for the rasterizer, callers keep x/y inside the buffer
+	float get(const int x, const int y) const { return depth[x + y * w]; }
+	float* row(const int y) { return depth.data() + y * w; }
+	const float* row(const int y) const { return depth.data() + y * w; }
+	const float* blockRow(const int y) const { return blockFar.data() + (y / blockSize) * bw; } // Hi-Z blocks covering pixel row y
+
+	// Depth test: keeps z and returns true when it is closer than what the pixel holds
+	bool testAndSet(const int x, const int y, const float z)
+	{
+		float& d = depth[x + y * w];
+		const bool closer = z > d;
+		d = closer ? z : d;
+		return closer;
+	}
+
+	// True when nothing at depth zmax or farther can pass the depth test anywhere in the rectangle (inclusive bounds)
+	bool occluded(const int minx, const int miny, const int maxx, const int maxy, const float zmax) const;
+
+	// Refreshes the Hi-Z blocks overlapping the rectangle after pixels in it were written
+	void updateBlocks(const int minx, const int miny, const int maxx, const int maxy);
+
+	// 8-bit grayscale copy for zBufferOutput.tga, NDC z in [-1, 1] maps to [0, 255]
+	TGAImage toImage() const;
+};
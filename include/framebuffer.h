@@ -0,0 +1,52 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+#include <tgaimage.h>
+
+// Color target of the rasterizer: one packed 32-bit BGRA pixel per pixel (blue in the low byte, so the bytes in memory
+// are in TGA order), rows stored contiguously from row 0 up, the base aligned to a cache line. Pixel writes are plain
+// unchecked stores through row pointers, instead of TGAImage::set()'s bounds check and bytes-per-pixel memcpy.
+// The pixels go to disk through a TGAView on them; TGAImage stays the type for reading and for other images.
+class FrameBuffer
+{
+	static constexpr std::size_t alignment = 64;
+
+	struct Free
+	{
+		void operator()(std::uint32_t* p) const { ::operator delete[](p, std::align_val_t(alignment)); }
+	};
+
+	int w = 0, h = 0;
+	std::uint8_t bpp = TGAImage::RGB; // Bytes per pixel written to the file, alpha only with RGBA
+	std::unique_ptr<std::uint32_t[], Free> pixels = {};
+
+public:
+	FrameBuffer() = default;
+	FrameBuffer(const int w, const int h, const TGAImage::Format format = TGAImage::RGB); // Cleared to 0
+	FrameBuffer(FrameBuffer&&) = default;
+	FrameBuffer& operator=(FrameBuffer&&) = default;
+
+	static std::uint32_t pack(const TGAColor& c)
+	{
+		return c.bgra[0] | c.bgra[1] << 8 | c.bgra[2] << 16 | static_cast<std::uint32_t>(c.bgra[3]) << 24;
+	}
+
+	int width() const { return w; }
+	int height() const { return h; }
+	bool empty() const { return !pixels; }
+	void clear(const std::uint32_t color = 0);
+
+	// Unchecked accessors for the rasterizer, callers keep x/y inside the buffer
+	std::uint32_t* row(const int y) { return pixels.get() + static_cast<std::size_t>(y) * w; }
+	const std::uint32_t* row(const int y) const { return pixels.get() + static_cast<std::size_t>(y) * w; }
+	std::uint32_t get(const int x, const int y) const { return row(y)[x]; }
+	void set(const int x, const int y, const std::uint32_t color) { row(y)[x] = color; }
+	void fill(const int x0, const int x1, const int y, const std::uint32_t color) { std::fill(row(y) + x0, row(y) + x1 + 1, color); } // Span [x0, x1] of row y
+
+	// The pixels as TGAImage's writer sees them, row 0 at the bottom of the picture like TGAImage's default
+	TGAView view() const { return { reinterpret_cast<const std::uint8_t*>(pixels.get()), w, h, bpp, 4, false }; }
+	bool write_tga_file(const std::string& filename, const bool rle = true) const { return view().write_tga_file(filename, true, rle); }
+};
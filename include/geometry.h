@@ -3,6 +3,11 @@
 #include <cassert>
 #include <iostream>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GEOMETRY_SSE
+#endif
+
 template<int n> struct vec {
     double data[n] = {0};
     double& operator[](const int i)       { assert(i>=0 && i<n); return data[i]; }
@@ -185,3 +190,125 @@ template<> struct dt<1> {   // template specialization to stop the recursion
     }
 };
 
+
+// Single precision counterparts for the hot path. They are 16-byte aligned so one SSE register holds a whole
+// vector (vec3f carries an unused 4th lane that stays 0), and the operators below are written out by hand
+// instead of going through the generic templates above. The double types stay the general purpose API.
+
+struct alignas(16) vec3f {
+    float x = 0, y = 0, z = 0, pad = 0;
+    float& operator[](const int i)       { assert(i>=0 && i<3); return i ? (1==i ? y : z) : x; }
+    float  operator[](const int i) const { assert(i>=0 && i<3); return i ? (1==i ? y : z) : x; }
+};
+
+struct alignas(16) vec4f {
+    float x = 0, y = 0, z = 0, w = 0;
+    float& operator[](const int i)       { assert(i>=0 && i<4); return i<2 ? (i ? y : x) : (2==i ? z : w); }
+    float  operator[](const int i) const { assert(i>=0 && i<4); return i<2 ? (i ? y : x) : (2==i ? z : w); }
+    vec3f xyz() const { return {x, y, z}; }
+};
+
+struct alignas(16) mat4f {
+    vec4f rows[4] = {};
+          vec4f& operator[] (const int idx)       { assert(idx>=0 && idx<4); return rows[idx]; }
+    const vec4f& operator[] (const int idx) const { assert(idx>=0 && idx<4); return rows[idx]; }
+};
+
+inline vec3f tofloat(const vec3& v) { return {float(v.x), float(v.y), float(v.z)}; }
+inline vec4f tofloat(const vec4& v) { return {float(v.x), float(v.y), float(v.z), float(v.w)}; }
+inline mat4f tofloat(const mat<4,4>& m) {
+    mat4f ret;
+    for (int i=4; i--; ret[i]=tofloat(m[i]));
+    return ret;
+}
+
+#ifdef GEOMETRY_SSE
+inline __m128 load(const vec3f& v) { return _mm_load_ps(&v.x); }
+inline __m128 load(const vec4f& v) { return _mm_load_ps(&v.x); }
+template<typename V> V store(const __m128 r) { V ret; _mm_store_ps(&ret.x, r); return ret; }
+
+inline float hsum(const __m128 v) { // x+y+z+w
+    __m128 t = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1,0,3,2)));
+    return _mm_cvtss_f32(_mm_add_ss(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(2,3,0,1))));
+}
+
+inline vec3f operator+(const vec3f& lhs, const vec3f& rhs) { return store<vec3f>(_mm_add_ps(load(lhs), load(rhs))); }
+inline vec3f operator-(const vec3f& lhs, const vec3f& rhs) { return store<vec3f>(_mm_sub_ps(load(lhs), load(rhs))); }
+inline vec3f operator*(const vec3f& lhs, const float rhs)  { return store<vec3f>(_mm_mul_ps(load(lhs), _mm_set1_ps(rhs))); }
+inline float operator*(const vec3f& lhs, const vec3f& rhs) { return hsum(_mm_mul_ps(load(lhs), load(rhs))); }
+inline vec4f operator+(const vec4f& lhs, const vec4f& rhs) { return store<vec4f>(_mm_add_ps(load(lhs), load(rhs))); }
+inline vec4f operator-(const vec4f& lhs, const vec4f& rhs) { return store<vec4f>(_mm_sub_ps(load(lhs), load(rhs))); }
+inline vec4f operator*(const vec4f& lhs, const float rhs)  { return store<vec4f>(_mm_mul_ps(load(lhs), _mm_set1_ps(rhs))); }
+inline float operator*(const vec4f& lhs, const vec4f& rhs) { return hsum(_mm_mul_ps(load(lhs), load(rhs))); }
+
+inline vec3f cross(const vec3f& v1, const vec3f& v2) { // v1.yzx*v2.zxy - v1.zxy*v2.yzx, the padding lane stays 0
+    const __m128 a = load(v1), b = load(v2);
+    const __m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3,0,2,1)), b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3,0,2,1));
+    const __m128 c = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b)); // zxy order
+    return store<vec3f>(_mm_shuffle_ps(c, c, _MM_SHUFFLE(3,0,2,1)));
+}
+
+inline vec3f normalized(const vec3f& v) {
+    const __m128 r = load(v);
+    return store<vec3f>(_mm_div_ps(r, _mm_set1_ps(std::sqrt(hsum(_mm_mul_ps(r, r))))));
+}
+
+inline vec4f operator*(const mat4f& lhs, const vec4f& rhs) { // Sum of the columns weighted by rhs
+    __m128 c0 = load(lhs[0]), c1 = load(lhs[1]), c2 = load(lhs[2]), c3 = load(lhs[3]);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    const __m128 v = load(rhs);
+    const __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_shuffle_ps(v, v, _MM_SHUFFLE(0,0,0,0))), _mm_mul_ps(c1, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1,1,1,1)))),
+                                _mm_add_ps(_mm_mul_ps(c2, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2,2,2,2))), _mm_mul_ps(c3, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3,3,3,3)))));
+    return store<vec4f>(r);
+}
+
+inline mat4f operator*(const mat4f& lhs, const mat4f& rhs) { // Row i of the product is row i of lhs weighting the rows of rhs
+    const __m128 b0 = load(rhs[0]), b1 = load(rhs[1]), b2 = load(rhs[2]), b3 = load(rhs[3]);
+    mat4f result;
+    for (int i=4; i--; ) {
+        const vec4f& a = lhs[i];
+        result[i] = store<vec4f>(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a.x), b0), _mm_mul_ps(_mm_set1_ps(a.y), b1)),
+                                            _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a.z), b2), _mm_mul_ps(_mm_set1_ps(a.w), b3))));
+    }
+    return result;
+}
+#else
+inline vec3f operator+(const vec3f& lhs, const vec3f& rhs) { return {lhs.x+rhs.x, lhs.y+rhs.y, lhs.z+rhs.z}; }
+inline vec3f operator-(const vec3f& lhs, const vec3f& rhs) { return {lhs.x-rhs.x, lhs.y-rhs.y, lhs.z-rhs.z}; }
+inline vec3f operator*(const vec3f& lhs, const float rhs)  { return {lhs.x*rhs, lhs.y*rhs, lhs.z*rhs}; }
+inline float operator*(const vec3f& lhs, const vec3f& rhs) { return lhs.x*rhs.x + lhs.y*rhs.y + lhs.z*rhs.z; }
+inline vec4f operator+(const vec4f& lhs, const vec4f& rhs) { return {lhs.x+rhs.x, lhs.y+rhs.y, lhs.z+rhs.z, lhs.w+rhs.w}; }
+inline vec4f operator-(const vec4f& lhs, const vec4f& rhs) { return {lhs.x-rhs.x, lhs.y-rhs.y, lhs.z-rhs.z, lhs.w-rhs.w}; }
+inline vec4f operator*(const vec4f& lhs, const float rhs)  { return {lhs.x*rhs, lhs.y*rhs, lhs.z*rhs, lhs.w*rhs}; }
+inline float operator*(const vec4f& lhs, const vec4f& rhs) { return lhs.x*rhs.x + lhs.y*rhs.y + lhs.z*rhs.z + lhs.w*rhs.w; }
+
+inline vec3f cross(const vec3f& v1, const vec3f& v2) {
+    return {v1.y*v2.z - v1.z*v2.y, v1.z*v2.x - v1.x*v2.z, v1.x*v2.y - v1.y*v2.x};
+}
+
+inline vec3f normalized(const vec3f& v) {
+    const float n = std::sqrt(v*v);
+    return {v.x/n, v.y/n, v.z/n};
+}
+
+inline vec4f operator*(const mat4f& lhs, const vec4f& rhs) {
+    return {lhs[0]*rhs, lhs[1]*rhs, lhs[2]*rhs, lhs[3]*rhs};
+}
+
+inline mat4f operator*(const mat4f& lhs, const mat4f& rhs) {
+    mat4f result;
+    for (int i=4; i--; )
+        for (int j=4; j--; )
+            result[i][j] = lhs[i][0]*rhs[0][j] + lhs[i][1]*rhs[1][j] + lhs[i][2]*rhs[2][j] + lhs[i][3]*rhs[3][j];
+    return result;
+}
+#endif
+
+inline vec3f operator*(const float lhs, const vec3f& rhs) { return rhs * lhs; }
+inline vec4f operator*(const float lhs, const vec4f& rhs) { return rhs * lhs; }
+inline vec3f operator/(const vec3f& lhs, const float rhs) { return lhs * (1.0f / rhs); }
+inline vec4f operator/(const vec4f& lhs, const float rhs) { return lhs * (1.0f / rhs); }
+inline float norm(const vec3f& v) { return std::sqrt(v*v); }
+
+inline std::ostream& operator<<(std::ostream& out, const vec3f& v) { return out << v.x << " " << v.y << " " << v.z << " "; }
+inline std::ostream& operator<<(std::ostream& out, const vec4f& v) { return out << v.x << " " << v.y << " " << v.z << " " << v.w << " "; }
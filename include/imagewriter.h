@@ -0,0 +1,46 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <variant>
+#include <framebuffer.h>
+#include <tgaimage.h>
+
+// Writes finished images to disk on a background thread, so the caller can start on the next frame while the
+// previous one is encoded. At most `capacity` images wait in the queue; submit() blocks when it is full, which keeps
+// the memory bounded when rendering outpaces the disk. The destructor writes everything still queued.
+class ImageWriter
+{
+	struct Job
+	{
+		std::variant<TGAImage, FrameBuffer> image;
+		std::string filename;
+	};
+
+	std::size_t capacity;
+	std::deque<Job> queue = {};
+	std::mutex mutex;
+	std::condition_variable changed;
+	bool busy = false; // The writer holds a job it took off the queue
+	bool stopping = false;
+	int failures = 0;
+	std::thread worker;
+
+	void run();
+	void push(Job&& job);
+
+public:
+	explicit ImageWriter(const std::size_t capacity = 3);
+	~ImageWriter();
+	ImageWriter(const ImageWriter&) = delete;
+	ImageWriter& operator=(const ImageWriter&) = delete;
+
+	// Takes the image over and queues it to be written as an RLE TGA with the usual bottom-left origin
+	void submit(TGAImage&& image, std::string filename);
+	void submit(FrameBuffer&& image, std::string filename);
+
+	// Waits until every submitted image is on disk, false if any of them failed to write since the last flush
+	bool flush();
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file, the OS pages it in on demand so nothing is copied up front
+class MappedFile
+{
+	const char* bytes = nullptr;
+	std::size_t length = 0;
+	bool opened = false;
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#else
+	int fd = -1;
+#endif
+
+public:
+	explicit MappedFile(const std::string& filename);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool is_open() const { return opened; }
+	const char* data() const { return bytes; }
+	std::size_t size() const { return length; }
+};
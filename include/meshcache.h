@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include <clusters.h>
+#include <mappedfile.h>
+#include <vertexcache.h>
+#include <vertexformat.h>
+
+// Binary copy of a parsed OBJ, stored next to it as "<model.obj>.mcache".
+// It is only trusted while the OBJ still has the size and modification time recorded in the header.
+struct MeshCacheHeader
+{
+	static constexpr std::uint32_t currentVersion = 7; // Bump whenever the layout below or the data after it changes
+	static constexpr std::uint32_t validated = 1; // Flag: written by writeMeshCache(), every index was checked on the way in
+
+	char magic[8] = { 'O', 'G', 'L', 'M', 'E', 'S', 'H', '\0' };
+	std::uint32_t version = currentVersion;
+	std::uint32_t positionFormat = 0; // PositionFormat
+	std::uint64_t sourceSize = 0;
+	std::int64_t sourceTime = 0; // OBJ last write time, in the file clock's native ticks
+	std::uint64_t nverts = 0; // Followed by nverts * 3 position components in positionFormat
+	std::uint64_t nindices = 0; // Then nindices vertex indices in indexFormat, 3 per face. Both arrays are padded to 4 bytes.
+	std::uint64_t nclusters = 0; // Then the face clusters, and the face ids they point into (nindices / 3 of them)
+	std::uint32_t nuvs = 0; // Then nuvs * 2 texture coordinates, and if there are any nindices uv indices after the normals
+	std::uint32_t nnormals = 0; // Then nnormals * 3 normal components, and likewise nindices normal indices last
+	std::uint32_t order = 0; // MeshOrder of the faces and vertices above
+	float acmrBefore = 0, acmrAfter = 0; // Vertex cache miss ratio in file order and in the stored order
+	std::uint32_t indexFormat = 0; // IndexFormat
+	float weldEpsilon = -1; // ModelLoadOptions::weldEpsilon the vertices were welded with, negative when they were not
+	QuantizationGrid grid = {}; // Of Quantized16 positions
+	std::uint32_t flags = 0;
+};
+static_assert(sizeof(MeshCacheHeader) == 112, "the cache header is read straight from the mapping");
+
+// Everything a cache file holds besides the header
+struct MeshCacheArrays
+{
+	PositionView positions = {};
+	IndexView indices = {};
+	std::span<const Cluster> clusters = {};
+	std::span<const std::uint32_t> clusterFaces = {};
+	std::span<const float> uvs = {};
+	std::span<const float> normals = {};
+	std::span<const std::uint32_t> uvIndices = {}; // Empty, or one per entry of `indices`
+	std::span<const std::uint32_t> normalIndices = {};
+	MeshOrderStats ordering = {};
+	float weldEpsilon = -1;
+};
+
+std::string meshCachePath(const std::string& objFilename);
+
+// Maps the cache of objFilename and points the arrays into it. Returns nullptr when there is no usable cache.
+// The indices are range checked with a pass over the whole mapping when `verify` is set, in debug builds, or when the
+// cache is not flagged as validated. Otherwise the mapping is used without reading it.
+std::unique_ptr<MappedFile> openMeshCache(const std::string& objFilename, MeshCacheArrays& arrays, const bool verify = false);
+
+// Writes the cache through a temporary file, so concurrent runs never see a half written one
+bool writeMeshCache(const std::string& objFilename, const MeshCacheArrays& arrays);
+
+// Reads the positions and faces of a mesh cache a piece at a time with plain file reads instead of mapping it, so
+// memory only holds what the caller asked for last (see renderStreamed()). Same validity rules as openMeshCache().
+class MeshCacheStream
+{
+	std::ifstream file = {};
+	MeshCacheHeader header = {};
+	std::vector<char> buffer = {}; // Raw bytes of the last read
+	std::uint64_t bytesRead = 0;
+
+	bool read(const std::uint64_t offset, const std::uint64_t bytes);
+
+public:
+	bool open(const std::string& objFilename); // False when there is no usable cache
+	std::uint64_t nverts() const { return header.nverts; }
+	std::uint64_t nfaces() const { return header.nindices / 3; }
+	std::uint64_t bytes() const { return bytesRead; } // Read from the file so far
+
+	// The read functions are false when the range runs past the cache or the file read fails.
+	// The 3 vertex ids of each face in [first, first + count), whatever their stored width. Not checked against nverts().
+	bool readFaces(const std::uint64_t first, const std::uint64_t count, std::vector<std::uint32_t>& indices);
+	// Appends the x, y, z floats of vertices [first, first + count), quantized ones decoded
+	bool readPositions(const std::uint64_t first, const std::uint64_t count, std::vector<float>& positions);
+};
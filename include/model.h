@@ -1,15 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <span>
 #include <vector>
+#include <clusters.h>
 #include <geometry.h>
+#include <mappedfile.h>
+#include <parallel.h>
+#include <vertexcache.h>
+#include <vertexformat.h>
+
+struct ModelLoadOptions
+{
+	unsigned threads = defaultThreadCount(); // Large OBJ files are parsed in chunks on this many workers
+	bool cache = true; // Load from / save to the binary cache next to the OBJ
+	MeshOrder order = MeshOrder::File; // Optional reordering for vertex cache reuse, paid once when the OBJ is parsed. Changes which face gets which flat color.
+	bool weld = false; // Merge vertices that share a cell of a weldEpsilon grid (exact duplicates with 0), see weldVertices()
+	float weldEpsilon = 0;
+	bool verifyCache = false; // Range check every index of a mapped cache, not only of ones writeMeshCache() did not flag as validated
+};
 
 class Model
 {
-	std::vector<vec3> verts = {};
-	std::vector<int> face_vert = {};
+	// Positions and 3 vertex indices per face, each in the smallest format that holds them (see compact()). They point
+	// either into the vectors below, filled by the OBJ parser, or straight into the memory mapped mesh cache.
+	PositionView verts = {};
+	IndexView face_vert = {};
+	std::span<const Cluster> faceClusters = {}; // Built on load and kept in the cache
+	std::span<const std::uint32_t> clusterFaceIds = {}; // Face ids the clusters point into
+
+	// Texture coordinates (u, v) and normals (x, y, z) from the vt/vn records, and the index of each face corner into
+	// them. The index arrays are empty when no face refers to that attribute, and hold noAttribute for single corners without one.
+	std::span<const float> uvs = {};
+	std::span<const float> norms = {};
+	std::span<const std::uint32_t> face_tex = {};
+	std::span<const std::uint32_t> face_norm = {};
+
+	std::vector<float> vertStorage = {}; // Float32 positions, or the parsed ones until compact()
+	std::vector<std::uint16_t> quantizedStorage = {};
+	std::vector<std::uint32_t> indexStorage = {}; // UInt32 indices, or the parsed ones until compact()
+	std::vector<std::uint16_t> narrowIndexStorage = {};
+	std::vector<float> uvStorage = {}, normalStorage = {};
+	std::vector<std::uint32_t> uvIndexStorage = {}, normalIndexStorage = {};
+	ClusterSet clusterStorage = {};
+	std::unique_ptr<MappedFile> cacheFile = {};
+	MeshOrderStats ordering = {};
+
+	bool loadObj(const std::string& filename, const unsigned threads);
+	void weld(const float epsilon);
+	void optimizeVertexCache(const MeshOrder order);
+	void compact(const float tolerance);
+	void buildFaceClusters(const unsigned threads, const bool sequential = false);
 
 public:
-	Model(const std::string filename);
+	static constexpr std::uint32_t noAttribute = 0xFFFFFFFF;
+
+	Model(const std::string filename, const ModelLoadOptions& options = {});
+	// Procedural meshes, 3 indices per face. sequentialClusters trades cluster quality for build time (see
+	// buildSequentialClusters()), for meshes that are drawn once and dropped. The clusters are built on `threads` workers.
+	Model(std::vector<float> positions, std::vector<std::uint32_t> indices, const bool sequentialClusters = false, const unsigned threads = defaultThreadCount());
+	Model(const Model&) = delete; // The spans would keep pointing at the other model's storage
+	Model& operator=(const Model&) = delete;
+
 	int nverts() const; // Number of vertices
 	int nfaces() const; // Number of faces
 	vec3 vert(const int i) const;
 	vec3 vert(const int iface, const int nthvert) const;
-};
\ No newline at end of file
+	vec3f vertf(const int iface, const int nthvert) const; // Same as vert(), without leaving single precision
+	int vertIndex(const int iface, const int nthvert) const; // Which vertex is corner `nthvert` of face `iface`
+	PositionView positions() const { return verts; } // All vertices, as floats or quantized
+	IndexView indices() const { return face_vert; } // All faces as 3 vertex ids each, 16 or 32 bit
+	bool hasUVs() const { return !face_tex.empty(); }
+	bool hasNormals() const { return !face_norm.empty(); }
+	vec2 uv(const int iface, const int nthvert) const; // Texture coordinate of a corner, (0, 0) when it has none
+	vec3 normal(const int iface, const int nthvert) const; // Normal of a corner as stored in the file, (0, 0, 0) when it has none
+	std::span<const Cluster> clusters() const { return faceClusters; }
+	std::span<const std::uint32_t> clusterFaces(const Cluster& cluster) const { return clusterFaceIds.subspan(cluster.first, cluster.count); }
+	const MeshOrderStats& meshOrder() const { return ordering; } // How the faces and vertices were reordered on load
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Number of worker threads to use when the user does not ask for a specific count
+inline unsigned defaultThreadCount()
+{
+	unsigned n = std::thread::hardware_concurrency();
+	return n ? n : 1;
+}
+
+// Runs fn(i) for every i in [0, count) on up to `threads` workers.
+// Indices are handed out one at a time through an atomic counter, so uneven work (e.g. busy vs empty tiles) balances itself.
+// With a single thread everything runs inline on the caller, in order.
+template<typename F> void parallelFor(const int count, unsigned threads, F&& fn)
+{
+	threads = std::clamp(threads, 1u, static_cast<unsigned>(std::max(count, 1)));
+	if (threads == 1)
+	{
+		for (int i = 0; i < count; i++) fn(i);
+		return;
+	}
+
+	std::atomic<int> next = 0;
+	auto worker = [&]()
+	{
+		for (int i = next++; i < count; i = next++) fn(i);
+	};
+
+	std::vector<std::thread> pool;
+	pool.reserve(threads - 1);
+	for (unsigned t = 1; t < threads; t++) pool.emplace_back(worker);
+	worker(); // The calling thread does its share too
+	for (std::thread& t : pool) t.join();
+}
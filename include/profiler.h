@@ -0,0 +1,46 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Pipeline stages timed by ScopedTimer. Tile and Chunk scopes run on the workers, so their totals add up
+// the time of every thread and can exceed the wall time of the stage around them.
+enum class Stage { Load, Transform, Chunk, Cull, Bin, Raster, Tile, Edges, Lines, Encode, OutputWait, StreamRead, StreamWait, Count };
+
+// Work counters, filled once per pass from the per-worker stats rather than per pixel
+enum class Counter { TrianglesSubmitted, Clusters, ClusterFaces, TrianglesOutside, TrianglesBackfacing, TrianglesClipped, TrianglesDegenerate, TrianglesHiZ, PixelsTested, PixelsWritten, Lines, LinePixels, Count };
+
+const char* stageName(const Stage stage);
+const char* counterName(const Counter counter);
+
+// Profiling is off by default and then costs one branch per scope. With `trace` every scope is also
+// kept as an event for writeChromeTrace(). Call before any worker thread starts.
+void enableProfiling(const bool trace);
+bool profilingEnabled();
+
+void addCount(const Counter counter, const std::uint64_t n);
+std::uint64_t count(const Counter counter);
+
+// Stage/counter breakdown as a text table, `wallMs` is the whole run the percentages refer to
+void printProfile(std::ostream& out, const double wallMs);
+
+// Chrome trace-event JSON (chrome://tracing, Perfetto, speedscope), one track per thread
+bool writeChromeTrace(const std::string& filename);
+
+// Times the enclosing scope as `stage`, when profiling is enabled
+class ScopedTimer
+{
+	Stage stage;
+	bool active;
+	std::chrono::steady_clock::time_point start = {};
+
+public:
+	explicit ScopedTimer(const Stage stage) : stage(stage), active(profilingEnabled())
+	{
+		if (active) start = std::chrono::steady_clock::now();
+	}
+	~ScopedTimer();
+	ScopedTimer(const ScopedTimer&) = delete;
+	ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
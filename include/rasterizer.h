@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <shader.h>
+#include <texture.h>
+#include <tgaimage.h>
+#include <depthbuffer.h>
+#include <framebuffer.h>
+#include <tiler.h>
+
+// Which inner loop fills the covered pixels, both produce exactly the same image
+enum class RasterMode { Scalar, Simd };
+
+bool simdRasterAvailable(); // False when the build target has no SSE2/AVX2, Simd then falls back to Scalar
+const char* simdRasterName(); // "AVX2", "SSE2" or "none"
+
+// Rasterizer switches that are fixed for a whole frame
+struct RasterOptions
+{
+	RasterMode mode = RasterMode::Simd;
+	bool hiZ = true; // Reject triangles and 8x8 blocks against the coarse depth before any per-pixel work
+	bool clusterCulling = true; // Reject whole face clusters by frustum and normal cone before the per-face tests
+	bool subpixel = false; // Vertices in subpixelBits fixed point, pixel centers sampled with a top-left fill rule
+	TextureFilter filter = TextureFilter::Bilinear; // Texel lookup of textured triangles
+	bool mipmaps = true; // Textured triangles sample the mip level matching their footprint, otherwise always the full size texture
+};
+
+// Fractional bits of vertex positions in subpixel mode (28.4 fixed point)
+constexpr int subpixelBits = 4;
+
+// Work done and work the Hi-Z test saved, kept per worker and summed after the frame
+struct RasterStats
+{
+	std::uint64_t hiZTriangles = 0; // Triangles rejected whole (per tile when counted by a tile worker)
+	std::uint64_t hiZPixels = 0; // Bounding box pixels never evaluated, from whole triangles and single blocks
+	std::uint64_t pixelsTested = 0; // Pixels inside a triangle that reached the depth test
+	std::uint64_t pixelsWritten = 0; // Pixels that passed it
+	std::uint64_t outside = 0, backfacing = 0, degenerate = 0; // Triangles the face loop dropped before calling triangle()
+	std::uint64_t clipped = 0; // Triangles cut at the near plane
+	std::uint64_t clusters = 0, clusterFaces = 0; // Clusters rejected whole, and the faces they held
+	RasterStats& operator+=(const RasterStats& other);
+};
+
+// Screen space vertex: integer position plus NDC depth. The position is in whole pixels, or in 1/16 pixels when
+// RasterOptions::subpixel is set. rhw (1/w) weights the vertex attributes for perspective correct interpolation.
+struct RasterVertex
+{
+	int x = 0, y = 0;
+	double z = 0;
+	float rhw = 1;
+};
+
+// Zero area on the pixel grid, triangle() draws nothing for these
+bool degenerate(const RasterVertex& a, const RasterVertex& b, const RasterVertex& c);
+
+// Pixels the triangle can cover, for binning. In subpixel mode only pixels whose center lies inside the bounding box.
+void pixelBounds(const RasterVertex& a, const RasterVertex& b, const RasterVertex& c, const bool subpixel, int& minx, int& miny, int& maxx, int& maxy);
+
+// Rasterizes the part of the triangle that falls inside `clip` (the whole screen, or one tile when rendering in parallel).
+// Coverage comes from integer edge functions stepped incrementally along each row, so no per-pixel divisions or cross products.
+// On the pixel grid a pixel on an edge is covered by both triangles sharing it. In subpixel mode pixels are sampled at
+// their centers and a center exactly on an edge only belongs to the triangle for which it is a top or left edge,
+// so meshes are drawn without cracks and without a pixel hit twice.
+// Every pixel that passes the depth test gets shader.fragment() of the corners' varyings, interpolated perspective
+// correctly (varying/w and 1/w are linear on screen, the division happens per pixel).
+// Returns false when the Hi-Z test rejected the whole triangle (inside `clip`).
+// Instantiated in rasterizer.cpp for the shaders of shader.h, a new shader needs its line there.
+template<Shader S>
+bool triangle(const RasterVertex& a, const RasterVertex& b, const RasterVertex& c, const S& shader, const typename S::Face& constants, const Varyings<S::varyings> (&corners)[3], const Tile& clip, DepthBuffer& depth, FrameBuffer& frameBuffer, const RasterOptions& options, RasterStats& stats);
+
+// The same triangle in one flat color
+bool triangle(const RasterVertex& a, const RasterVertex& b, const RasterVertex& c, const TGAColor color, const Tile& clip, DepthBuffer& depth, FrameBuffer& frameBuffer, const RasterOptions& options, RasterStats& stats);
@@ -0,0 +1,42 @@
+#pragma once
+#include <span>
+#include <tuple>
+#include <vector>
+#include <camera.h>
+#include <depthbuffer.h>
+#include <framebuffer.h>
+#include <geometry.h>
+#include <model.h>
+#include <rasterizer.h>
+#include <shader.h>
+#include <texture.h>
+#include <tgaimage.h>
+#include <vertexstage.h>
+
+// BGRA order
+constexpr TGAColor white = { 255, 255, 255, 255 };
+constexpr TGAColor green = { 0, 255, 0, 255 };
+constexpr TGAColor red = { 0, 0, 255, 255 };
+constexpr TGAColor blue = { 255, 128, 64, 255 };
+constexpr TGAColor yellow = { 0, 200, 255, 255 };
+
+int line(int ax, int ay, int bx, int by, FrameBuffer& frameBuffer, TGAColor color); // Bresenham, clipped to the frame by drawSegment(). Returns the number of pixels plotted
+bool isBackFacing(const vec3f& v0, const vec3f& v1, const vec3f& v2, const vec3f& eye);
+std::tuple<int, int, double> project(const mat<4, 4>& viewport, const vec4& vector); // Per-vertex reference path, transformVertices() does the same in bulk
+
+// One rand() color per face, in face order. rand() is not thread safe, so call it before any worker starts.
+std::vector<TGAColor> randomFaceColors(const int nfaces);
+
+// How renderFaces() colors the faces
+struct Shading
+{
+	ShaderKind kind = ShaderKind::Flat;
+	std::span<const TGAColor> colors = {}; // Flat: one color per face
+	const Texture* texture = nullptr; // Texture, and the diffuse color of Phong. Only used when the model has texture coordinates.
+	vec3f light = normalized(vec3f{ 1, 1, 1 }); // Direction towards the light in model space, for the lit shaders
+};
+
+// --faces: fills every front facing triangle of the view with the chosen shader. Texture falls back to Flat when
+// there is no texture or the model has no texture coordinates. More than one thread switches to the tile-binned
+// renderer, which produces exactly the same image.
+void renderFaces(const Model& model, const View& view, const ScreenVertices& screen, const Shading& shading, DepthBuffer& zBuffer, FrameBuffer& frameBuffer, const unsigned threads, const RasterOptions& options, RasterStats& stats);
@@ -0,0 +1,214 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <span>
+#include <geometry.h>
+#include <model.h>
+#include <texture.h>
+#include <tgaimage.h>
+
+// Shaders are compile-time parameters of triangle() and the face loops, so every shader gets its own inlined inner
+// loop: no virtual call and no shading-mode branch per pixel. A shader provides
+//   varyings                  how many floats each corner hands to its pixels, interpolated perspective correctly
+//   derivatives               whether fragments also get the screen space derivatives of those (texture LOD)
+//   writesColor               false for depth-only passes, the rasterizer then never touches the color buffer
+//   Face, face(i)             per-face constants (flat attributes), computed once per face and passed by value
+//   vertex(i, k)              the varyings of corner k of face i, called once per corner of every drawn face
+//   fragment(constants, f)    color of a pixel that passed the depth test
+// The shaders below are the ones the renderer offers, each is instantiated once in rasterizer.cpp.
+
+template<int N> using Varyings = std::array<float, N>;
+
+// What fragment() gets: the interpolated varyings, and with `derivatives` their change one pixel right / one row down
+template<int N>
+struct Fragment
+{
+	Varyings<N> value = {};
+	Varyings<N> ddx = {}, ddy = {};
+};
+
+template<typename S>
+concept Shader = requires(const S& shader, const int face, const int corner, const typename S::Face& constants, const Fragment<S::varyings>& fragment)
+{
+	{ shader.face(face) } -> std::same_as<typename S::Face>;
+	{ shader.vertex(face, corner) } -> std::same_as<Varyings<S::varyings>>;
+	{ shader.fragment(constants, fragment) } -> std::same_as<TGAColor>;
+	{ S::derivatives } -> std::convertible_to<bool>;
+	{ S::writesColor } -> std::convertible_to<bool>;
+};
+
+// Which shader renderFaces() runs
+enum class ShaderKind { Flat, Gouraud, Phong, Normals, Depth, Texture };
+
+struct NoConstants {};
+
+constexpr float ambient = 0.1f; // Light every lit shader gives to surfaces facing away from the light
+
+inline std::uint8_t toChannel(const float v) { return static_cast<std::uint8_t>(std::clamp(v, 0.0f, 255.0f)); }
+
+// Normal of a face corner: the one from the file when there is one, the face's geometric normal otherwise. Unit length.
+vec3f cornerNormal(const Model& model, const int face, const int corner);
+
+// Mip level and sample of `texture` at texture coordinate (u, v) = (varyings k, k + 1) of the fragment
+template<int N>
+TGAColor sampleTexture(const Texture& texture, const Fragment<N>& f, const int k, const TextureFilter filter, const bool mipmaps)
+{
+	int level = 0;
+	if (mipmaps)
+	{
+		const float width = static_cast<float>(texture.width()), height = static_cast<float>(texture.height());
+		const float ux = f.ddx[k] * width, vx = f.ddx[k + 1] * height, uy = f.ddy[k] * width, vy = f.ddy[k + 1] * height;
+		level = texture.mipLevel(std::max(ux * ux + vx * vx, uy * uy + vy * vy)); // Footprint of the pixel in level 0 texels
+	}
+	return texture.sample(f.value[k], f.value[k + 1], level, filter);
+}
+
+// Every face in its own color, the original --faces look
+class FlatShader
+{
+	std::span<const TGAColor> colors;
+
+public:
+	static constexpr int varyings = 0;
+	static constexpr bool derivatives = false, writesColor = true;
+	using Face = TGAColor;
+
+	explicit FlatShader(std::span<const TGAColor> colors) : colors(colors) {}
+	TGAColor face(const int i) const { return colors[i]; }
+	Varyings<0> vertex(const int, const int) const { return {}; }
+	TGAColor fragment(const TGAColor& color, const Fragment<0>&) const { return color; }
+};
+
+// Depth test and depth write only, the color buffer is never read or written. For depth prepasses and shadow maps.
+class DepthShader
+{
+public:
+	static constexpr int varyings = 0;
+	static constexpr bool derivatives = false, writesColor = false;
+	using Face = NoConstants;
+
+	NoConstants face(const int) const { return {}; }
+	Varyings<0> vertex(const int, const int) const { return {}; }
+	TGAColor fragment(const NoConstants&, const Fragment<0>&) const { return {}; }
+};
+
+// Diffuse light computed at the corners and interpolated across the face (Gouraud), in gray
+class GouraudShader
+{
+	const Model& model;
+	vec3f light;
+
+public:
+	static constexpr int varyings = 1;
+	static constexpr bool derivatives = false, writesColor = true;
+	using Face = NoConstants;
+
+	GouraudShader(const Model& model, const vec3f& light) : model(model), light(light) {}
+	NoConstants face(const int) const { return {}; }
+	Varyings<1> vertex(const int face, const int corner) const
+	{
+		return { ambient + (1 - ambient) * std::max(0.0f, cornerNormal(model, face, corner) * light) };
+	}
+	TGAColor fragment(const NoConstants&, const Fragment<1>& f) const
+	{
+		const std::uint8_t gray = toChannel(f.value[0] * 255);
+		return { gray, gray, gray, 255 };
+	}
+};
+
+// Blinn-Phong per pixel from the interpolated normal and position. The diffuse color comes from the texture when
+// Textured (the model needs texture coordinates), white otherwise.
+template<bool Textured>
+class PhongShader
+{
+	const Model& model;
+	vec3f light, eye;
+	const Texture* texture;
+	TextureFilter filter;
+	bool mipmaps;
+
+public:
+	static constexpr int varyings = Textured ? 8 : 6; // Normal, position, then u and v
+	static constexpr bool derivatives = Textured, writesColor = true;
+	using Face = NoConstants;
+
+	PhongShader(const Model& model, const vec3f& light, const vec3f& eye, const Texture* texture = nullptr, const TextureFilter filter = TextureFilter::Bilinear, const bool mipmaps = true)
+		: model(model), light(light), eye(eye), texture(texture), filter(filter), mipmaps(mipmaps) {}
+
+	NoConstants face(const int) const { return {}; }
+	Varyings<varyings> vertex(const int face, const int corner) const
+	{
+		const vec3f n = cornerNormal(model, face, corner), p = model.vertf(face, corner);
+		Varyings<varyings> out = { n.x, n.y, n.z, p.x, p.y, p.z };
+		if constexpr (Textured)
+		{
+			const vec2 uv = model.uv(face, corner);
+			out[6] = static_cast<float>(uv.x);
+			out[7] = static_cast<float>(uv.y);
+		}
+		return out;
+	}
+
+	TGAColor fragment(const NoConstants&, const Fragment<varyings>& f) const
+	{
+		const vec3f n = normalized(vec3f{ f.value[0], f.value[1], f.value[2] });
+		const vec3f toEye = normalized(eye - vec3f{ f.value[3], f.value[4], f.value[5] });
+		const float diffuse = std::max(0.0f, n * light);
+		float specular = std::max(0.0f, n * normalized(light + toEye));
+		for (int i = 0; i < 5; i++) specular *= specular; // Shininess 32
+		TGAColor base = { 255, 255, 255, 255 };
+		if constexpr (Textured) base = sampleTexture(*texture, f, 6, filter, mipmaps);
+		const float lit = ambient + (1 - ambient) * diffuse, highlight = 128 * specular;
+		return { toChannel(base.bgra[0] * lit + highlight), toChannel(base.bgra[1] * lit + highlight), toChannel(base.bgra[2] * lit + highlight), 255 };
+	}
+};
+
+// The interpolated unit normal as a color, x, y and z mapped from [-1, 1] to red, green and blue
+class NormalShader
+{
+	const Model& model;
+
+public:
+	static constexpr int varyings = 3;
+	static constexpr bool derivatives = false, writesColor = true;
+	using Face = NoConstants;
+
+	explicit NormalShader(const Model& model) : model(model) {}
+	NoConstants face(const int) const { return {}; }
+	Varyings<3> vertex(const int face, const int corner) const
+	{
+		const vec3f n = cornerNormal(model, face, corner);
+		return { n.x, n.y, n.z };
+	}
+	TGAColor fragment(const NoConstants&, const Fragment<3>& f) const
+	{
+		const vec3f n = normalized(vec3f{ f.value[0], f.value[1], f.value[2] });
+		return { toChannel((n.z + 1) * 127.5f), toChannel((n.y + 1) * 127.5f), toChannel((n.x + 1) * 127.5f), 255 };
+	}
+};
+
+// Unlit texture lookup at the interpolated texture coordinates, the mip level from their screen space derivatives
+class TextureShader
+{
+	const Model& model;
+	const Texture& texture;
+	TextureFilter filter;
+	bool mipmaps;
+
+public:
+	static constexpr int varyings = 2;
+	static constexpr bool derivatives = true, writesColor = true;
+	using Face = NoConstants;
+
+	TextureShader(const Model& model, const Texture& texture, const TextureFilter filter = TextureFilter::Bilinear, const bool mipmaps = true)
+		: model(model), texture(texture), filter(filter), mipmaps(mipmaps && texture.mipLevels() > 1) {}
+	NoConstants face(const int) const { return {}; }
+	Varyings<2> vertex(const int face, const int corner) const
+	{
+		const vec2 uv = model.uv(face, corner);
+		return { static_cast<float>(uv.x), static_cast<float>(uv.y) };
+	}
+	TGAColor fragment(const NoConstants&, const Fragment<2>& f) const { return sampleTexture(texture, f, 0, filter, mipmaps); }
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <renderer.h>
+
+struct StreamOptions
+{
+	std::uint32_t chunkFaces = 1 << 18; // Faces per chunk. A chunk holds them, their vertices and the screen positions of those, which is what bounds the memory.
+};
+
+struct StreamStats
+{
+	std::uint64_t chunks = 0;
+	std::uint64_t vertices = 0; // Read and transformed, a vertex shared by several chunks counts once for each
+	std::uint64_t bytes = 0; // Read from the cache file
+	std::uint64_t peakChunkBytes = 0; // Largest chunk, three of them are alive at a time at most
+	double waitMs = 0; // Rendering blocked on the reader, the part of the I/O that did not overlap with rasterizing
+};
+
+// --stream: renders faces from the mesh cache of objFilename without ever holding the whole mesh. A reader thread reads
+// the next chunk of faces and the vertices they use while the current one is transformed and rasterized into the
+// persistent depth and frame buffers, then the chunk is dropped. Chunks follow the cache's face order, in which a
+// vertex cache ordering (--reorder all) keeps each chunk's vertices in a few runs that are read in one go.
+// Faces reach the buffers in the same order as from renderFaces(), so the image is the same as long as no triangle
+// crosses the near plane. Clipped pieces are numbered after the faces of their chunk rather than of the whole mesh,
+// so where they tie in depth with other faces the pixel may come out differently. Chunks carry positions only, so
+// `shading` is Flat or Depth, the shaders that need nothing else (main rejects --stream with the others).
+// Flat colors are drawn with rand() chunk by chunk, the same sequence randomFaceColors() gives the whole mesh.
+// False when there is no usable cache (a normal load writes it) or a read fails.
+bool renderStreamed(const std::string& objFilename, const View& view, const Shading& shading, DepthBuffer& zBuffer, FrameBuffer& frameBuffer, const unsigned threads, const RasterOptions& options, const StreamOptions& streamOptions, RasterStats& stats, StreamStats& streamStats);
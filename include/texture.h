@@ -0,0 +1,105 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <tgaimage.h>
+
+// How a texel is picked at the chosen mip level
+enum class TextureFilter { Nearest, Bilinear };
+
+// Texture coordinate of a triangle corner, (0, 0) is the bottom left of the image and coordinates outside [0, 1] repeat
+struct TexCoord
+{
+	float u = 0, v = 0;
+};
+
+// Diffuse map ready for sampling: packed BGRA texels and the whole mip chain down to 1x1, built once on load.
+// Every level is stored in 4x4 texel tiles of 64 bytes (one cache line), Morton ordered inside the tile, with the tiles
+// row-major. A bilinear footprint then mostly stays in one line, and a minified triangle that was given the matching
+// mip level walks a few lines per row of pixels instead of one line per texel.
+// The per-pixel calls (mipLevel, sample) are inline, the rasterizer calls them for every textured pixel.
+class Texture
+{
+	static constexpr int tileSize = 4; // Texels per tile side
+
+	struct Level
+	{
+		int width = 0, height = 0;
+		int tilesX = 0; // Tiles per row of tiles
+		size_t offset = 0; // First texel of the level in `texels`
+	};
+
+	std::vector<Level> levels = {};
+	std::vector<std::uint32_t> texels = {};
+
+	// Index of a texel in `texels`, x and y already wrapped. Inside a tile the bits of x and y interleave, so 2x2 quads are contiguous.
+	static size_t address(const Level& level, const int x, const int y)
+	{
+		const int inTile = (x & 1) | (y & 1) << 1 | (x & 2) << 1 | (y & 2) << 2;
+		return level.offset + static_cast<size_t>((y / tileSize) * level.tilesX + x / tileSize) * (tileSize * tileSize) + inTile;
+	}
+
+	static TGAColor unpack(const std::uint32_t t)
+	{
+		return { static_cast<std::uint8_t>(t), static_cast<std::uint8_t>(t >> 8), static_cast<std::uint8_t>(t >> 16), static_cast<std::uint8_t>(t >> 24) };
+	}
+
+	// Channel-wise a + (b - a) * w / 256 on packed BGRA, two channels per multiply (each lane keeps 16 bits)
+	static std::uint32_t lerp(const std::uint32_t a, const std::uint32_t b, const std::uint32_t w)
+	{
+		const std::uint32_t rb = (((a & 0x00FF00FF) * (256 - w) + (b & 0x00FF00FF) * w) >> 8) & 0x00FF00FF;
+		const std::uint32_t ga = (((a >> 8) & 0x00FF00FF) * (256 - w) + ((b >> 8) & 0x00FF00FF) * w) & 0xFF00FF00;
+		return rb | ga;
+	}
+
+	static int floorInt(const float f) // std::floor for values well inside the int range, without the libm call
+	{
+		const int i = static_cast<int>(f);
+		return i - (f < static_cast<float>(i));
+	}
+
+public:
+	Texture() = default;
+	explicit Texture(const TGAImage& image); // Grayscale images are spread to gray BGR, images without alpha get 255
+
+	bool load(const std::string& filename); // read_tga_file(), then builds the mip chain. False if the file could not be read.
+	bool empty() const { return levels.empty(); }
+	int width() const { return empty() ? 0 : levels[0].width; }
+	int height() const { return empty() ? 0 : levels[0].height; }
+	int mipLevels() const { return static_cast<int>(levels.size()); }
+
+	// Mip level for a pixel covering `footprint2` (squared) level 0 texels along its longer axis, rounded to the nearest level
+	int mipLevel(const float footprint2) const
+	{
+		// log2 of the footprint rounded to the nearest integer is floor(log2(2 * footprint2) / 2), straight from the float exponent
+		if (!(footprint2 > 1)) return 0; // Magnified, or NaN from a degenerate mapping
+		const int exponent = static_cast<int>(std::bit_cast<std::uint32_t>(footprint2) >> 23) - 126; // floor(log2(2 * footprint2)), infinity gives 129
+		return std::min(exponent >> 1, mipLevels() - 1);
+	}
+
+	// Texel of a level, coordinates repeat
+	TGAColor texel(const int level, const int x, const int y) const;
+
+	// Color at (u, v) on mip level `level`
+	TGAColor sample(const float u, const float v, const int level, const TextureFilter filter) const
+	{
+		const Level& l = levels[level];
+		const float fu = (u - floorInt(u)) * l.width, fv = (v - floorInt(v)) * l.height; // Repeat, then texel units
+
+		if (filter == TextureFilter::Nearest)
+		{
+			return unpack(texels[address(l, std::min(static_cast<int>(fu), l.width - 1), std::min(static_cast<int>(fv), l.height - 1))]);
+		}
+
+		// Bilinear between the four texel centers around the point, the ones past an edge wrap to the other side
+		const int sx = floorInt(fu - 0.5f), sy = floorInt(fv - 0.5f);
+		const std::uint32_t wx = static_cast<std::uint32_t>((fu - 0.5f - sx) * 256), wy = static_cast<std::uint32_t>((fv - 0.5f - sy) * 256);
+		const int x0 = sx < 0 ? l.width - 1 : std::min(sx, l.width - 1), y0 = sy < 0 ? l.height - 1 : std::min(sy, l.height - 1);
+		const int x1 = x0 + 1 < l.width ? x0 + 1 : 0, y1 = y0 + 1 < l.height ? y0 + 1 : 0;
+		const std::uint32_t bottom = lerp(texels[address(l, x0, y0)], texels[address(l, x1, y0)], wx);
+		const std::uint32_t top = lerp(texels[address(l, x0, y1)], texels[address(l, x1, y1)], wx);
+		return unpack(lerp(bottom, top, wy));
+	}
+};
@@ -1,6 +1,8 @@
 #pragma once
 #include <cstdint>
 #include <fstream>
+#include <memory>
+#include <string>
 #include <vector>
 
 #pragma pack(push,1)
@@ -26,6 +28,19 @@ struct TGAColor {
     std::uint8_t& operator[](const int i) { return bgra[i]; }
 };
 
+// Pixels owned by someone else, in TGAImage's row order: w*h pixels `stride` bytes apart, of which the first `bpp`
+// bytes (BGR or BGRA) are written. Lets a packed 32-bit render target be encoded as it is, without a copy.
+struct TGAView {
+    const std::uint8_t *data = nullptr;
+    int w = 0, h = 0;
+    std::uint8_t bpp = 0;    // bytes per pixel in the file
+    std::uint8_t stride = 0; // bytes per pixel in memory, at least bpp
+    bool bottom_up = false;  // the first stored row is the bottom one
+    bool write_tga_file(const std::string filename, const bool vflip=true, const bool rle=true) const;
+private:
+    size_t unload_rle_data(std::unique_ptr<std::uint8_t[]> &out) const;
+};
+
 struct TGAImage {
     enum Format { GRAYSCALE=1, RGB=3, RGBA=4 };
     TGAImage() = default;
@@ -34,15 +49,18 @@ struct TGAImage {
     bool write_tga_file(const std::string filename, const bool vflip=true, const bool rle=true) const;
     void flip_horizontally();
     void flip_vertically();
+    void store_top_down(); // physically reorders the rows, for code that needs them top row first in memory
     TGAColor get(const int x, const int y) const;
     void set(const int x, const int y, const TGAColor &c);
     int width()  const;
     int height() const;
+    TGAView view() const { return {data.data(), w, h, bpp, bpp, bottom_up}; }
 private:
     bool   load_rle_data(std::ifstream &in);
-    bool unload_rle_data(std::ofstream &out) const;
+    int row(const int y) const { return bottom_up ? h-1-y : y; } // storage row of image row y
     int w = 0, h = 0;
     std::uint8_t bpp = 0;
+    bool bottom_up = false; // the first stored row is the bottom one, as in most TGA files
     std::vector<std::uint8_t> data = {};
 };
 
@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+#include <parallel.h>
+#include <profiler.h>
+
+// Screen-space rectangle owned by exactly one worker while rasterizing, bounds are inclusive
+struct Tile
+{
+	int minx = 0, miny = 0, maxx = 0, maxy = 0;
+	int index = 0; // Position in the binner, handy for per-tile scratch data
+	std::vector<int> tris = {}; // Triangle ids overlapping this tile, in submission order
+};
+
+// Sorts triangles into fixed-size screen tiles so tiles can be rasterized in parallel.
+// Every pixel belongs to a single tile, so workers never touch the same framebuffer bytes and need no locks.
+// Triangles keep their submission order inside a tile, which keeps the depth test results identical to a serial render.
+class TileBinner
+{
+	int width, height, tileSize;
+	int tilesX, tilesY;
+	std::vector<Tile> tiles = {};
+
+public:
+	TileBinner(const int width, const int height, const int tileSize = 64); // tileSize must be a multiple of DepthBuffer::blockSize
+	bool bin(const int tri, int minx, int miny, int maxx, int maxy); // Adds a triangle to every tile its bounding box touches, false if none
+	void clear(); // Empties the bins but keeps their memory for the next frame
+	int ntiles() const;
+	const Tile& tile(const int i) const;
+
+	// Calls fn(tile, tri) for each binned triangle, tiles spread over `threads` workers
+	template<typename F> void rasterize(const unsigned threads, F&& fn) const
+	{
+		parallelFor(ntiles(), threads, [&](const int i)
+		{
+			const Tile& t = tiles[i];
+			if (t.tris.empty()) return;
+			ScopedTimer timer(Stage::Tile);
+			for (int tri : t.tris) fn(t, tri);
+		});
+	}
+};
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// How the faces and vertices of a model are ordered after loading, kept in the mesh cache with the data
+enum class MeshOrder : std::uint32_t
+{
+	File = 0, // As the OBJ lists them
+	Faces = 1, // Faces reordered for vertex cache reuse
+	FacesAndVertices = 2, // Then vertices renumbered in order of first use, so neighbouring faces read neighbouring positions
+};
+
+// What reordering did to a model, reported on load and kept in the mesh cache so a cached model can report it too
+struct MeshOrderStats
+{
+	MeshOrder order = MeshOrder::File;
+	float acmrBefore = 0, acmrAfter = 0; // acmr() in file order and in the final order
+};
+
+// Entries of the FIFO cache acmr() simulates, a common size for hardware post-transform caches
+constexpr int acmrCacheSize = 16;
+
+// Average cache miss ratio: vertices transformed per triangle when `indices` (3 per face) go through a FIFO
+// post-transform cache of `cacheSize` entries. 3 means no reuse at all, a regular grid gets down to about 0.6.
+double acmr(std::span<const std::uint32_t> indices, const int nverts, const int cacheSize = acmrCacheSize);
+
+// Face order with high vertex cache reuse, after Tom Forsyth's "Linear-Speed Vertex Cache Optimisation": faces are
+// picked greedily by the scores of their vertices, which reward a recent position in a 32 entry LRU cache and
+// vertices with few faces left, so no vertex is left behind with a lone face. Returns the face ids in their new order.
+std::vector<std::uint32_t> optimizeFaceOrder(std::span<const std::uint32_t> indices, const int nverts);
+
+// New id of every vertex when they are numbered in order of first use by `indices`, unused vertices last
+std::vector<std::uint32_t> vertexFetchOrder(std::span<const std::uint32_t> indices, const int nverts);
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <geometry.h>
+
+// Storage formats Model picks for its positions and vertex indices once a mesh is loaded, see Model::compact()
+enum class PositionFormat : std::uint32_t
+{
+	Float32 = 0, // x, y, z floats, 12 bytes per vertex
+	Quantized16 = 1, // x, y, z as 16 bit steps of a grid over the bounding box, 6 bytes per vertex
+};
+
+enum class IndexFormat : std::uint32_t
+{
+	UInt32 = 0,
+	UInt16 = 1, // Meshes of up to 65536 vertices
+};
+
+// The grid of Quantized16 positions: component c is offset[c] + q * step[c], q in [0, 65535]
+struct QuantizationGrid
+{
+	float offset[3] = {}, step[3] = {};
+
+	float decode(const int c, const std::uint16_t q) const { return offset[c] + static_cast<float>(q) * step[c]; }
+};
+
+// Read-only positions of a model in either format, `floats` or `quantized` is empty. Indexed by vertex.
+struct PositionView
+{
+	std::span<const float> floats = {};
+	std::span<const std::uint16_t> quantized = {};
+	QuantizationGrid grid = {};
+
+	PositionFormat format() const { return quantized.empty() ? PositionFormat::Float32 : PositionFormat::Quantized16; }
+	size_t size() const { return (floats.size() + quantized.size()) / 3; } // Number of vertices
+	vec3f operator[](const size_t i) const
+	{
+		if (quantized.empty()) return { floats[i * 3], floats[i * 3 + 1], floats[i * 3 + 2] };
+		return { grid.decode(0, quantized[i * 3]), grid.decode(1, quantized[i * 3 + 1]), grid.decode(2, quantized[i * 3 + 2]) };
+	}
+	size_t size_bytes() const { return floats.size_bytes() + quantized.size_bytes(); }
+	const void* data() const { return quantized.empty() ? static_cast<const void*>(floats.data()) : quantized.data(); }
+};
+
+// Read-only vertex indices of a model in either format, `wide` or `narrow` is empty. 3 per face, like a span of them.
+struct IndexView
+{
+	std::span<const std::uint32_t> wide = {};
+	std::span<const std::uint16_t> narrow = {};
+
+	IndexFormat format() const { return narrow.empty() ? IndexFormat::UInt32 : IndexFormat::UInt16; }
+	size_t size() const { return wide.size() + narrow.size(); }
+	std::uint32_t operator[](const size_t i) const { return narrow.empty() ? wide[i] : narrow[i]; }
+	size_t size_bytes() const { return wide.size_bytes() + narrow.size_bytes(); }
+	const void* data() const { return narrow.empty() ? static_cast<const void*>(wide.data()) : narrow.data(); }
+};
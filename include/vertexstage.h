@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <geometry.h>
+#include <rasterizer.h>
+#include <vertexformat.h>
+
+// Screen space position of every model vertex, one array per component (structure of arrays)
+struct ScreenVertices
+{
+	std::vector<int> x = {}, y = {}; // Pixel coordinates, truncated towards zero like project() does, or rounded 28.4 fixed point
+	int subpixelBits = 0; // Fractional bits of x and y, 0 for whole pixels
+	std::vector<float> z = {}; // NDC depth
+	std::vector<float> rhw = {}; // 1/w, for perspective correct attributes
+	std::vector<std::uint8_t> clip = {}; // ClipBits outcode against the near plane and the framebuffer edges
+	mat4f transform = {}; // Matrix the positions went through, to rebuild the homogeneous corners of triangles that need clipping
+
+	int size() const { return static_cast<int>(x.size()); }
+	RasterVertex operator[](const int i) const { return { x[i], y[i], z[i], rhw[i] }; }
+};
+
+// Transforms every vertex (x, y, z triples in `positions`) exactly once with the combined
+// Viewport * Perspective * ModelView matrix, including the perspective divide, and classifies it against
+// the near plane and the width x height framebuffer.
+// Coordinates are clamped to +-2^24 so vertices at or behind the eye cannot overflow the integer rasterizer,
+// triangles using such vertices have to go through clipNear() first.
+// With subpixelBits (see RasterOptions::subpixel) x and y keep that many fractional bits, rounded instead of truncated.
+void transformVertices(std::span<const float> positions, const mat<4, 4>& viewportProjectionModelView, const int width, const int height, ScreenVertices& out, const unsigned threads, const bool simd = true, const int subpixelBits = 0);
+
+// Same for positions in either storage format, quantized ones are decoded to floats a chunk at a time on the worker
+void transformVertices(const PositionView& positions, const mat<4, 4>& viewportProjectionModelView, const int width, const int height, ScreenVertices& out, const unsigned threads, const bool simd = true, const int subpixelBits = 0);
+
+// The per-vertex steps of transformVertices(), bit for bit: homogeneous position, then the divide to a pixel
+vec4f toClip(const mat4f& m, const float x, const float y, const float z);
+RasterVertex toRaster(const vec4f& p, const int subpixelBits = 0);
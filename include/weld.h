@@ -0,0 +1,9 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Merges vertices whose positions fall in the same cell of a grid of `epsilon` sized cubes, or with epsilon 0 the exact
+// duplicates (0 and -0 count as equal). The first vertex of every cell is kept and `positions` (x, y, z per vertex)
+// shrinks to those, in their original order. Returns the new id of every old vertex.
+// Two positions closer than epsilon can still straddle a cell border and stay apart, the key is the cell alone.
+std::vector<std::uint32_t> weldVertices(std::vector<float>& positions, const float epsilon);
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <framebuffer.h>
+#include <model.h>
+#include <tgaimage.h>
+#include <vertexstage.h>
+
+// Every edge of the mesh exactly once, as the two vertex ids with the lower one first. Faces share most of their
+// edges, so this is about half of the 3 per face the face loop would draw. Built once per model, used for every view.
+struct EdgeList
+{
+	std::vector<std::uint32_t> from = {}, to = {};
+	int size() const { return static_cast<int>(from.size()); }
+};
+
+// Unique edges of the faces in `indices` (3 vertex ids per face), ordered by their lower vertex id.
+// Edges from a vertex to itself are left out.
+EdgeList buildEdges(const IndexView& indices, const int nverts, const unsigned threads);
+
+// Bresenham segment from a to b in whole pixels, both ends included
+struct Segment
+{
+	int ax = 0, ay = 0, bx = 0, by = 0;
+};
+
+// Draws the pixels of the segment that fall inside the rectangle (inclusive bounds), without any per-pixel check.
+// The segment is clipped up front in its own step count, so the pixels drawn are exactly the ones line() would plot
+// there, however far outside the ends lie. Rows of a shallow segment go out as spans. Returns the pixels drawn.
+int drawSegment(const Segment& s, const int minx, const int miny, const int maxx, const int maxy, FrameBuffer& frameBuffer, const std::uint32_t color);
+
+// --wireframe: red edges and white vertex dots. Edges with both ends outside the same clip plane are skipped, edges
+// crossing the near plane are cut there. More than one thread draws the frame in horizontal bands of rows, each
+// worker owning its rows, with the same image as a single thread.
+void renderWireframe(const Model& model, const EdgeList& edges, const ScreenVertices& screen, FrameBuffer& frameBuffer, const unsigned threads);
@@ -1,6 +1,16 @@
 #include <iostream>
+#include <algorithm>
+#include <bit>
 #include <cstring>
+#include <memory>
 #include "tgaimage.h"
+#include <parallel.h>
+#include <profiler.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TGA_SSE2
+#endif
 
 TGAImage::TGAImage(const int w, const int h, const int bpp) : w(w), h(h), bpp(bpp), data(w*h*bpp, 0) {}
 
@@ -41,8 +51,7 @@ bool TGAImage::read_tga_file(const std::string filename) {
         std::cerr << "unknown file format " << (int)header.datatypecode << "\n";
         return false;
     }
-    if (!(header.imagedescriptor & 0x20))
-        flip_vertically();
+    bottom_up = !(header.imagedescriptor & 0x20); // kept as stored, get/set and the writer follow the origin instead of flipping
     if (header.imagedescriptor & 0x10)
         flip_horizontally();
     std::cerr << w << "x" << h << "/" << bpp*8 << "\n";
@@ -98,98 +107,241 @@ bool TGAImage::load_rle_data(std::ifstream &in) {
     return true;
 }
 
+namespace {
+    // Pixels of the image being encoded, `stride` bytes apart, the first `bpp` bytes of each go to the file
+    struct pixels {
+        const std::uint8_t *p;
+        int bpp, stride;
+        const std::uint8_t *at(const size_t i) const { return p+i*stride; }
+    };
+
+    // Is pixel i the same color as pixel i+1
+    inline bool same_as_next(const pixels &px, const size_t i) {
+        return !memcmp(px.at(i), px.at(i+1), px.bpp);
+    }
+
+    // First i in [from, limit) where same_as_next(i) == equal, or limit. Pixel `limit` has to exist.
+    size_t find_pair(const pixels &px, size_t from, const size_t limit, const bool equal) {
+#if defined(TGA_SSE2)
+        // Compares 16 bytes against the same 16 bytes one pixel later, which settles 16/stride pixel pairs at once
+        const int stride = px.stride;
+        if (stride==1 || stride==3 || stride==4) {
+            const int step = 16/stride;
+            const std::uint32_t lanes = stride==1 ? 0xFFFF : (stride==3 ? 0x1249 : 0x1111); // first byte of each whole pixel
+            for (; (from+1)*stride+16 <= (limit+1)*stride; from += step) {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(px.at(from)));
+                const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(px.at(from+1)));
+                std::uint32_t m = _mm_movemask_epi8(_mm_cmpeq_epi8(a, b));
+                std::uint32_t same = m;
+                for (int t=1; t<px.bpp; t++) same &= m>>t; // a pixel pair is equal when all of its written bytes are
+                const std::uint32_t hits = (equal ? same : ~same) & lanes;
+                if (hits) return std::min(limit, from + std::countr_zero(hits)/stride);
+            }
+        }
+#endif
+        for (; from<limit; from++)
+            if (same_as_next(px, from)==equal) return from;
+        return limit;
+    }
+
+    // Length in pixels of the packet the greedy encoder starts at pixel q: a run of up to 128 equal pixels,
+    // or up to 128 raw pixels that stops right before the next pair of equal ones
+    size_t rle_packet(const pixels &px, const size_t q, const size_t npixels, bool &raw) {
+        raw = true;
+        if (q+1>=npixels) return 1;
+        const size_t limit = std::min(q+127, npixels-1);
+        if (same_as_next(px, q)) {
+            raw = false;
+            return find_pair(px, q+1, limit, false) - q + 1;
+        }
+        const size_t j = find_pair(px, q+1, limit, true);
+        return j<limit ? j-q : limit-q+1;
+    }
+
+    // Copies n pixels from q on, dropping the bytes of each that are not written
+    std::uint8_t *put_pixels(std::uint8_t *dst, const pixels &px, const size_t q, const size_t n) {
+        if (px.stride==px.bpp) {
+            memcpy(dst, px.at(q), n*px.bpp);
+            return dst+n*px.bpp;
+        }
+        for (size_t i=q; i<q+n; i++, dst += px.bpp)
+            memcpy(dst, px.at(i), px.bpp);
+        return dst;
+    }
+
+    std::uint8_t *put_packet(std::uint8_t *dst, const pixels &px, const size_t q, const size_t length, const bool raw) {
+        *dst++ = raw ? length-1 : length+127;
+        return put_pixels(dst, px, q, raw ? length : 1);
+    }
+
+    // Encoded size of `pixels` pixels can't exceed this, a lone raw pixel costs 1+bpp bytes
+    size_t rle_bound(const size_t pixels, const int bpp) {
+        return (pixels+128)*(bpp+1);
+    }
+
+    // Packets of one band, encoded as if a packet started on the band's first pixel
+    struct rle_band {
+        static constexpr size_t max_starts = 1024; // packets remembered to catch up with, the serial pass almost always does within a few
+        size_t begin = 0, end = 0; // the band's pixels, the last packet may run past `end`
+        size_t stop = 0;           // pixel after the last packet
+        std::unique_ptr<std::uint8_t[]> bytes = {};
+        size_t size = 0;
+        std::vector<size_t> starts = {};  // first pixel of the first packets
+        std::vector<size_t> offsets = {}; // and where they begin in bytes
+    };
+
+    void encode_band(const pixels &px, const size_t npixels, rle_band &band) {
+        band.bytes.reset(new std::uint8_t[rle_bound(band.end-band.begin, px.bpp)]); // no need to zero it
+        std::uint8_t *dst = band.bytes.get();
+        size_t q = band.begin;
+        while (q<band.end) {
+            bool raw;
+            const size_t length = rle_packet(px, q, npixels, raw);
+            if (band.starts.size()<rle_band::max_starts) {
+                band.starts.push_back(q);
+                band.offsets.push_back(dst-band.bytes.get());
+            }
+            dst = put_packet(dst, px, q, length, raw);
+            q += length;
+        }
+        band.size = dst-band.bytes.get();
+        band.stop = q;
+    }
+}
+
 bool TGAImage::write_tga_file(const std::string filename, const bool vflip, const bool rle) const {
+    return view().write_tga_file(filename, vflip, rle);
+}
+
+bool TGAView::write_tga_file(const std::string filename, const bool vflip, const bool rle) const {
     constexpr std::uint8_t developer_area_ref[4] = {0, 0, 0, 0};
     constexpr std::uint8_t extension_area_ref[4] = {0, 0, 0, 0};
     constexpr std::uint8_t footer[18] = {'T','R','U','E','V','I','S','I','O','N','-','X','F','I','L','E','.','\0'};
+    ScopedTimer timer(Stage::Encode);
+    TGAHeader header = {};
+    header.bitsperpixel = bpp<<3;
+    header.width  = w;
+    header.height = h;
+    header.datatypecode = (bpp==TGAImage::GRAYSCALE ? (rle?11:3) : (rle?10:2));
+    header.imagedescriptor = vflip==bottom_up ? 0x20 : 0x00; // the rows go out as stored, the origin bit says which end they start at
+
+    // RLE files are put together in memory and written at once, raw ones go straight from the pixels
+    std::unique_ptr<std::uint8_t[]> packets;
+    size_t size = 0;
+    if (rle) size = unload_rle_data(packets);
+
     std::ofstream out;
     out.open(filename, std::ios::binary);
     if (!out.is_open()) {
         std::cerr << "can't open file " << filename << "\n";
         return false;
     }
-    TGAHeader header = {};
-    header.bitsperpixel = bpp<<3;
-    header.width  = w;
-    header.height = h;
-    header.datatypecode = (bpp==GRAYSCALE ? (rle?11:3) : (rle?10:2));
-    header.imagedescriptor = vflip ? 0x00 : 0x20; // top-left or bottom-left origin
-    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
-    if (!out.good()) goto err;
-    if (!rle) {
-        out.write(reinterpret_cast<const char *>(data.data()), w*h*bpp);
-        if (!out.good()) goto err;
-    } else if (!unload_rle_data(out)) goto err;
-    out.write(reinterpret_cast<const char *>(developer_area_ref), sizeof(developer_area_ref));
-    if (!out.good()) goto err;
-    out.write(reinterpret_cast<const char *>(extension_area_ref), sizeof(extension_area_ref));
-    if (!out.good()) goto err;
-    out.write(reinterpret_cast<const char *>(footer), sizeof(footer));
-    if (!out.good()) goto err;
+    if (rle) {
+        memcpy(packets.get(), &header, sizeof(header));
+        std::uint8_t *tail = packets.get()+size;
+        memcpy(tail, developer_area_ref, sizeof(developer_area_ref));
+        memcpy(tail+sizeof(developer_area_ref), extension_area_ref, sizeof(extension_area_ref));
+        memcpy(tail+sizeof(developer_area_ref)+sizeof(extension_area_ref), footer, sizeof(footer));
+        out.write(reinterpret_cast<const char *>(packets.get()), size+sizeof(developer_area_ref)+sizeof(extension_area_ref)+sizeof(footer));
+    } else {
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        if (stride==bpp) {
+            out.write(reinterpret_cast<const char *>(data), w*h*bpp);
+        } else {
+            // padded pixels are squeezed one row at a time
+            const pixels px = {data, bpp, stride};
+            std::unique_ptr<std::uint8_t[]> line(new std::uint8_t[w*bpp]);
+            for (int j=0; j<h; j++) {
+                put_pixels(line.get(), px, static_cast<size_t>(j)*w, w);
+                out.write(reinterpret_cast<const char *>(line.get()), w*bpp);
+            }
+        }
+        out.write(reinterpret_cast<const char *>(developer_area_ref), sizeof(developer_area_ref));
+        out.write(reinterpret_cast<const char *>(extension_area_ref), sizeof(extension_area_ref));
+        out.write(reinterpret_cast<const char *>(footer), sizeof(footer));
+    }
+    if (!out.good()) {
+        std::cerr << "can't dump the tga file\n";
+        return false;
+    }
     return true;
-err:
-    std::cerr << "can't dump the tga file\n";
-    return false;
 }
 
-bool TGAImage::unload_rle_data(std::ofstream &out) const {
-    const std::uint8_t max_chunk_length = 128;
-    size_t npixels = w*h;
-    size_t curpix = 0;
-    while (curpix<npixels) {
-        size_t chunkstart = curpix*bpp;
-        size_t curbyte = curpix*bpp;
-        std::uint8_t run_length = 1;
-        bool raw = true;
-        while (curpix+run_length<npixels && run_length<max_chunk_length) {
-            bool succ_eq = true;
-            for (int t=0; succ_eq && t<bpp; t++)
-                succ_eq = (data[curbyte+t]==data[curbyte+t+bpp]);
-            curbyte += bpp;
-            if (1==run_length)
-                raw = !succ_eq;
-            if (raw && succ_eq) {
-                run_length--;
+// Same packets as a single greedy pass over the whole image, packets still cross row ends.
+// Bands are encoded in parallel assuming a packet starts on their first pixel, then stitched in order: from where the
+// previous band really stopped, packets are encoded again until one starts where a packet of the band does, and from
+// there on the band's bytes are exactly what the serial pass would produce.
+// The packets land after room for the header, with room for the footer behind them. Returns where they end.
+size_t TGAView::unload_rle_data(std::unique_ptr<std::uint8_t[]> &out) const {
+    constexpr size_t min_band = 1<<16; // pixels, smaller images are not worth a thread
+    const size_t npixels = w*h;
+    const pixels px = {data, bpp, stride};
+    const unsigned threads = defaultThreadCount();
+    const size_t nbands = std::clamp<size_t>(npixels/min_band, 1, threads);
+
+    std::vector<rle_band> bands(nbands);
+    for (size_t b=0; b<nbands; b++) {
+        bands[b].begin = npixels*b/nbands;
+        bands[b].end   = npixels*(b+1)/nbands;
+    }
+    parallelFor(static_cast<int>(nbands), threads, [&](const int b) { encode_band(px, npixels, bands[b]); });
+
+    out.reset(new std::uint8_t[sizeof(TGAHeader) + rle_bound(npixels, bpp) + 64]);
+    std::uint8_t *dst = out.get()+sizeof(TGAHeader);
+    size_t q = 0;
+    for (const rle_band &band : bands) {
+        while (q<band.end) {
+            const auto it = std::lower_bound(band.starts.begin(), band.starts.end(), q);
+            if (it!=band.starts.end() && *it==q) { // in step with the band, take the rest of it as is
+                const size_t offset = band.offsets[it-band.starts.begin()];
+                memcpy(dst, band.bytes.get()+offset, band.size-offset);
+                dst += band.size-offset;
+                q = band.stop;
                 break;
             }
-            if (!raw && !succ_eq)
-                break;
-            run_length++;
+            bool raw;
+            const size_t length = rle_packet(px, q, npixels, raw);
+            dst = put_packet(dst, px, q, length, raw);
+            q += length;
         }
-        curpix += run_length;
-        out.put(raw ? run_length-1 : run_length+127);
-        if (!out.good()) return false;
-        out.write(reinterpret_cast<const char *>(data.data()+chunkstart), (raw?run_length*bpp:bpp));
-        if (!out.good()) return false;
     }
-    return true;
+    return dst-out.get();
 }
 
 TGAColor TGAImage::get(const int x, const int y) const {
     if (!data.size() || x<0 || y<0 || x>=w || y>=h) return {};
     TGAColor ret = {0, 0, 0, 0, bpp};
-    const std::uint8_t *p = data.data()+(x+y*w)*bpp;
+    const std::uint8_t *p = data.data()+(x+row(y)*w)*bpp;
     for (int i=bpp; i--; ret.bgra[i] = p[i]);
     return ret;
 }
 
 void TGAImage::set(int x, int y, const TGAColor &c) {
     if (!data.size() || x<0 || y<0 || x>=w || y>=h) return;
-    memcpy(data.data()+(x+y*w)*bpp, c.bgra, bpp);
+    memcpy(data.data()+(x+row(y)*w)*bpp, c.bgra, bpp);
 }
 
 void TGAImage::flip_horizontally() {
-    for (int i=0; i<w/2; i++)
-        for (int j=0; j<h; j++)
-            for (int b=0; b<bpp; b++)
-                std::swap(data[(i+j*w)*bpp+b], data[(w-1-i+j*w)*bpp+b]);
+    const size_t pixel = bpp;
+    for (int j=0; j<h; j++) {
+        std::uint8_t *line = data.data()+j*w*pixel;
+        for (int i=0; i<w/2; i++)
+            std::swap_ranges(line+i*pixel, line+(i+1)*pixel, line+(w-1-i)*pixel);
+    }
 }
 
+// Only the origin changes, the rows stay where they are
 void TGAImage::flip_vertically() {
-    for (int i=0; i<w; i++)
-        for (int j=0; j<h/2; j++)
-            for (int b=0; b<bpp; b++)
-                std::swap(data[(i+j*w)*bpp+b], data[(i+(h-1-j)*w)*bpp+b]);
+    bottom_up = !bottom_up;
+}
+
+// Reorders the rows in memory so they are stored top row first, one whole-row swap per pair
+void TGAImage::store_top_down() {
+    if (!bottom_up) return;
+    const size_t line = w*bpp;
+    for (int j=0; j<h/2; j++)
+        std::swap_ranges(data.begin()+j*line, data.begin()+(j+1)*line, data.begin()+(h-1-j)*line);
+    bottom_up = false;
 }
 
 int TGAImage::width() const {
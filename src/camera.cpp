@@ -0,0 +1,72 @@
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <camera.h>
+
+mat<4, 4> lookAt(const vec3 eye, const vec3 center, const vec3 up)
+{
+	vec3 n = normalized(eye - center);
+	vec3 l = normalized(cross(up, n));
+	vec3 m = normalized(cross(n, l));
+	return mat<4, 4>{{{l.x, l.y, l.z, 0}, {m.x, m.y, m.z, 0}, {n.x, n.y, n.z, 0}, {0, 0, 0, 1}}} *
+		mat<4, 4>{{{1, 0, 0, -center.x}, { 0, 1, 0, -center.y }, { 0, 0, 1, -center.z }, { 0, 0, 0, 1 }}};
+}
+
+mat<4, 4> perspective(const double f)
+{
+	return {{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, -1/f, 1}}};
+}
+
+mat<4, 4> viewport(const int x, const int y, const int w, const int h)
+{
+	return { {{w / 2., 0, 0, x + w / 2.}, {0, h / 2., 0, y + h / 2.}, {0, 0, 1, 0}, {0, 0, 0, 1}} };
+}
+
+View makeView(const Camera& camera, const int width, const int height)
+{
+	View view;
+	view.camera = camera;
+	view.modelView = lookAt(camera.eye, camera.center, camera.up);
+	view.perspective = perspective(1.0 / std::tan(camera.fov / 2.0)); // Perspective projection matrix
+	view.viewport = viewport(width / 16, height / 16, width * 7 / 8, height * 7 / 8); // Viewport transformation matrix
+	return view;
+}
+
+bool loadCameras(const std::string& filename, std::vector<Camera>& cameras)
+{
+	std::ifstream in(filename);
+	if (!in)
+	{
+		std::cerr << "Error: Cannot open camera list " << filename << "\n";
+		return false;
+	}
+
+	std::string text;
+	for (int number = 1; std::getline(in, text); number++)
+	{
+		std::istringstream line(text);
+		char first = 0;
+		if (!(line >> first) || first == '#') continue; // Blank or comment
+		line.putback(first);
+
+		Camera camera;
+		double degrees = 0;
+		line >> camera.eye.x >> camera.eye.y >> camera.eye.z >> camera.center.x >> camera.center.y >> camera.center.z
+			>> camera.up.x >> camera.up.y >> camera.up.z >> degrees;
+		std::string rest;
+		if (!line || line >> rest || degrees <= 0 || degrees >= 180 || norm(camera.eye - camera.center) == 0 || norm(cross(camera.up, camera.eye - camera.center)) == 0)
+		{
+			std::cerr << "Error: " << filename << ":" << number << ": expected \"eye center up fov\" (10 numbers, 0 < fov < 180, up not along the view direction): " << text << "\n";
+			return false;
+		}
+		camera.fov = degrees * std::numbers::pi / 180;
+		cameras.push_back(camera);
+	}
+	if (cameras.empty())
+	{
+		std::cerr << "Error: No cameras in " << filename << "\n";
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,51 @@
+#include <clipper.h>
+
+namespace
+{
+	// Point where the segment crosses w == clipNearW, `da` and `db` are the signed distances of its ends to the plane
+	vec4f intersect(const vec4f& a, const vec4f& b, const float da, const float db)
+	{
+		const float t = da / (da - db);
+		return { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, clipNearW };
+	}
+}
+
+int clipNear(const vec4f (&in)[3], vec4f (&out)[4])
+{
+	vec3f weights[4];
+	return clipNear(in, out, weights);
+}
+
+int clipNear(const vec4f (&in)[3], vec4f (&out)[4], vec3f (&weights)[4])
+{
+	static const vec3f corner[3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+	int n = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		const int j = (i + 1) % 3;
+		const vec4f& a = in[i];
+		const vec4f& b = in[j];
+		const float da = a.w - clipNearW, db = b.w - clipNearW;
+		if (da >= 0) // Keep vertices in front of the plane
+		{
+			weights[n] = corner[i];
+			out[n++] = a;
+		}
+		if ((da >= 0) != (db >= 0)) // And add one where an edge crosses it
+		{
+			const float t = da / (da - db);
+			weights[n] = corner[i] * (1 - t) + corner[j] * t;
+			out[n++] = intersect(a, b, da, db);
+		}
+	}
+	return n;
+}
+
+bool clipNear(vec4f& a, vec4f& b)
+{
+	const float da = a.w - clipNearW, db = b.w - clipNearW;
+	if (da < 0 && db < 0) return false;
+	if (da < 0) a = intersect(a, b, da, db);
+	else if (db < 0) b = intersect(a, b, da, db);
+	return true;
+}
@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <cmath>
+#include <clipper.h>
+#include <clusters.h>
+#include <parallel.h>
+
+namespace
+{
+	// Rounding slack, relative to the size of the numbers involved, so the float per-face tests never disagree with a rejection
+	constexpr double tolerance = 1e-4;
+
+	vec3 position(const PositionView& positions, const std::uint32_t v)
+	{
+		const vec3f p = positions[v];
+		return { p.x, p.y, p.z };
+	}
+
+	// Face normal exactly as isBackFacing() computes it, in float
+	vec3 faceNormal(const PositionView& positions, const IndexView& indices, const std::uint32_t f)
+	{
+		const vec3f v0 = tofloat(position(positions, indices[f * 3])), v1 = tofloat(position(positions, indices[f * 3 + 1])), v2 = tofloat(position(positions, indices[f * 3 + 2]));
+		const vec3f n = cross(v1 - v0, v2 - v0);
+		return { n.x, n.y, n.z };
+	}
+
+	// Faces of one cluster, listed in faces[first, first + count)
+	Cluster buildCluster(const PositionView& positions, const IndexView& indices, std::span<const std::uint32_t> faces, const std::uint32_t first, const std::uint32_t count)
+	{
+		Cluster cluster;
+		cluster.first = first;
+		cluster.count = count;
+		const std::span<const std::uint32_t> members = faces.subspan(first, count);
+
+		// Bounding sphere around the box of the corners
+		vec3 lo = position(positions, indices[members[0] * 3]), hi = lo;
+		for (const std::uint32_t f : members)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				const vec3 p = position(positions, indices[f * 3 + k]);
+				lo = { std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z) };
+				hi = { std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z) };
+			}
+		}
+		const vec3 center = (lo + hi) / 2.;
+		double radius = 0;
+		for (const std::uint32_t f : members)
+		{
+			for (int k = 0; k < 3; k++) radius = std::max(radius, norm(position(positions, indices[f * 3 + k]) - center));
+		}
+
+		// Normals as isBackFacing() computes them, in float. Faces with a zero normal are always culled there, so they do not widen the cone.
+		vec3 normals[clusterSize];
+		int nnormals = 0;
+		vec3 sum = {};
+		for (const std::uint32_t f : members)
+		{
+			const vec3 normal = faceNormal(positions, indices, f);
+			if (norm(normal) == 0) continue;
+			normals[nnormals] = normalized(normal);
+			sum = sum + normals[nnormals++];
+		}
+
+		double coneCos = -1;
+		if (norm(sum) > 0)
+		{
+			const vec3 axis = normalized(sum);
+			coneCos = 1;
+			for (int i = 0; i < nnormals; i++) coneCos = std::min(coneCos, normals[i] * axis);
+			cluster.axis[0] = static_cast<float>(axis.x);
+			cluster.axis[1] = static_cast<float>(axis.y);
+			cluster.axis[2] = static_cast<float>(axis.z);
+		}
+		cluster.coneSin = coneCos > 0 ? static_cast<float>(std::sqrt(1 - coneCos * coneCos) + tolerance) : 1;
+
+		cluster.center[0] = static_cast<float>(center.x);
+		cluster.center[1] = static_cast<float>(center.y);
+		cluster.center[2] = static_cast<float>(center.z);
+		cluster.radius = static_cast<float>(radius * (1 + tolerance) + tolerance * norm(center)); // Also covers rounding the center to float
+		return cluster;
+	}
+
+	// The cube face a normal points to, clusters never mix two of them so both sides of a thin wall never share a cone
+	std::uint64_t normalSide(const vec3& n)
+	{
+		const vec3 m = { std::abs(n.x), std::abs(n.y), std::abs(n.z) };
+		const int axis = m.x >= m.y && m.x >= m.z ? 0 : (m.y >= m.z ? 1 : 2);
+		return axis * 2 + (n[axis] < 0 ? 1 : 0);
+	}
+
+	// Bounds and cones of the clusters covering set.faces[first, first + count) for every range
+	void buildRanges(const PositionView& positions, const IndexView& indices, const std::vector<std::pair<std::uint32_t, std::uint32_t>>& ranges, ClusterSet& set, const unsigned threads)
+	{
+		set.clusters.resize(ranges.size());
+		parallelFor(static_cast<int>(ranges.size()), threads, [&](const int c)
+		{
+			const auto [first, count] = ranges[c];
+			std::sort(set.faces.begin() + first, set.faces.begin() + first + count); // File order inside the cluster, kinder to the caches
+			set.clusters[c] = buildCluster(positions, indices, set.faces, first, count);
+		});
+	}
+
+	// Spreads the low 20 bits of v three bits apart, for interleaving into a Morton code
+	std::uint64_t spreadBits(std::uint64_t v)
+	{
+		v &= 0xfffff;
+		v = (v | v << 32) & 0x001f00000000ffffull;
+		v = (v | v << 16) & 0x001f0000ff0000ffull;
+		v = (v | v << 8) & 0x100f00f00f00f00full;
+		v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+		v = (v | v << 2) & 0x1249249249249249ull;
+		return v;
+	}
+
+	// Sorts in parallel: one std::sort per slice, then rounds of pairwise merges
+	template<typename T> void parallelSort(std::vector<T>& items, const unsigned threads)
+	{
+		const int slices = static_cast<int>(std::clamp<size_t>(threads, 1, std::max<size_t>(items.size() / 65536, 1)));
+		auto bound = [&](const int s) { return items.begin() + items.size() * s / slices; };
+		parallelFor(slices, threads, [&](const int s) { std::sort(bound(s), bound(s + 1)); });
+		for (int width = 1; width < slices; width *= 2)
+		{
+			parallelFor((slices + 2 * width - 1) / (2 * width), threads, [&](const int m)
+			{
+				const int lo = m * 2 * width, mid = std::min(lo + width, slices), hi = std::min(lo + 2 * width, slices);
+				std::inplace_merge(bound(lo), bound(mid), bound(hi));
+			});
+		}
+	}
+}
+
+ClusterSet buildClusters(const PositionView& positions, const IndexView& indices, const unsigned threads)
+{
+	ClusterSet set;
+	const std::uint32_t nfaces = static_cast<std::uint32_t>(indices.size() / 3);
+	if (nfaces == 0) return set;
+
+	// Quantize face centers inside the bounding box of the mesh
+	vec3 lo = position(positions, 0), hi = lo;
+	for (size_t v = 0; v < positions.size(); v++)
+	{
+		const vec3 p = position(positions, static_cast<std::uint32_t>(v));
+		lo = { std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z) };
+		hi = { std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z) };
+	}
+	const double extent = std::max({ hi.x - lo.x, hi.y - lo.y, hi.z - lo.z, 1e-30 });
+	const double scale = ((1 << 20) - 1) / extent;
+
+	// Sort key: the cube face the normal points to, then the Morton code
+	std::vector<std::pair<std::uint64_t, std::uint32_t>> keys(nfaces);
+	constexpr int chunk = 1 << 14;
+	parallelFor((nfaces + chunk - 1) / chunk, threads, [&](const int c)
+	{
+		for (std::uint32_t f = c * chunk; f < std::min<std::uint32_t>(nfaces, (c + 1) * chunk); f++)
+		{
+			const vec3 a = position(positions, indices[f * 3]), b = position(positions, indices[f * 3 + 1]), d = position(positions, indices[f * 3 + 2]);
+			const vec3 q = ((a + b + d) / 3. - lo) * scale;
+			const std::uint64_t side = normalSide(faceNormal(positions, indices, f));
+			const std::uint64_t morton = spreadBits(static_cast<std::uint64_t>(q.x)) | spreadBits(static_cast<std::uint64_t>(q.y)) << 1 | spreadBits(static_cast<std::uint64_t>(q.z)) << 2;
+			keys[f] = { side << 60 | morton, f };
+		}
+	});
+	parallelSort(keys, threads);
+
+	// Cut into clusters, never letting one straddle two normal groups
+	set.faces.resize(nfaces);
+	for (std::uint32_t i = 0; i < nfaces; i++) set.faces[i] = keys[i].second;
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> ranges;
+	for (std::uint32_t i = 0; i < nfaces;)
+	{
+		const std::uint64_t side = keys[i].first >> 60;
+		std::uint32_t end = i;
+		while (end < nfaces && end - i < clusterSize && keys[end].first >> 60 == side) end++;
+		ranges.emplace_back(i, end - i);
+		i = end;
+	}
+	keys = {};
+	buildRanges(positions, indices, ranges, set, threads);
+	return set;
+}
+
+ClusterSet buildSequentialClusters(const PositionView& positions, const IndexView& indices, const unsigned threads)
+{
+	ClusterSet set;
+	const std::uint32_t nfaces = static_cast<std::uint32_t>(indices.size() / 3);
+	set.faces.resize(nfaces);
+	for (std::uint32_t f = 0; f < nfaces; f++) set.faces[f] = f;
+
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> ranges;
+	for (std::uint32_t i = 0; i < nfaces;)
+	{
+		const std::uint64_t side = normalSide(faceNormal(positions, indices, i));
+		std::uint32_t end = i + 1;
+		while (end < nfaces && end - i < clusterSize && normalSide(faceNormal(positions, indices, end)) == side) end++;
+		ranges.emplace_back(i, end - i);
+		i = end;
+	}
+	buildRanges(positions, indices, ranges, set, threads);
+	return set;
+}
+
+ClusterCuller::ClusterCuller(const mat4f& m, const int width, const int height, const vec3f& eye) : eye{ eye.x, eye.y, eye.z }
+{
+	auto row = [&](const int r) { return vec4{ m[r][0], m[r][1], m[r][2], m[r][3] }; };
+
+	// The outcode planes, see outcode(): w >= clipNearW, x > -w, x < width * w, y > -w, y < height * w
+	planes[0] = row(3) - vec4{ 0, 0, 0, clipNearW };
+	planes[1] = row(0) + row(3);
+	planes[2] = row(3) * static_cast<double>(width) - row(0);
+	planes[3] = row(1) + row(3);
+	planes[4] = row(3) * static_cast<double>(height) - row(1);
+}
+
+ClusterVisibility ClusterCuller::test(const Cluster& cluster) const
+{
+	const vec3 center = { cluster.center[0], cluster.center[1], cluster.center[2] };
+	const double radius = cluster.radius;
+
+	// Sphere entirely on the outer side of one plane
+	for (const vec4& plane : planes)
+	{
+		const vec3 normal = plane.xyz();
+		const double distance = normal * center + plane.w;
+		const double reach = radius * norm(normal);
+		if (distance + reach < -tolerance * (std::abs(plane.w) + norm(normal) * (norm(center) + radius))) return ClusterVisibility::Outside;
+	}
+
+	// Every normal in the cone points away from every point of the sphere as seen from the eye
+	if (cluster.coneSin < 1)
+	{
+		const vec3 axis = { cluster.axis[0], cluster.axis[1], cluster.axis[2] };
+		const vec3 toCluster = center - eye;
+		const double distance = norm(toCluster);
+		if (axis * toCluster - radius > (distance + radius) * cluster.coneSin) return ClusterVisibility::Backfacing;
+	}
+	return ClusterVisibility::Visible;
+}
@@ -0,0 +1,59 @@
+#include <algorithm>
+#include <depthbuffer.h>
+
+
+DepthBuffer::DepthBuffer(const int w, const int h)
+	: w(w), h(h), bw((w + blockSize - 1) / blockSize), bh((h + blockSize - 1) / blockSize),
+	  depth(static_cast<size_t>(w) * h, farthest), blockFar(static_cast<size_t>(bw) * bh, farthest) {}
+
+void DepthBuffer::clear()
+{
+	std::fill(depth.begin(), depth.end(), farthest);
+	std::fill(blockFar.begin(), blockFar.end(), farthest);
+}
+
+bool DepthBuffer::occluded(const int minx, const int miny, const int maxx, const int maxy, const float zmax) const
+{
+	for (int by = miny / blockSize; by <= maxy / blockSize; by++)
+	{
+		for (int bx = minx / blockSize; bx <= maxx / blockSize; bx++)
+		{
+			if (zmax > blockFar[bx + by * bw]) return false; // Could still win somewhere in this block
+		}
+	}
+	return true;
+}
+
+void DepthBuffer::updateBlocks(const int minx, const int miny, const int maxx, const int maxy)
+{
+	for (int by = miny / blockSize; by <= maxy / blockSize; by++)
+	{
+		const int y1 = std::min(h, (by + 1) * blockSize);
+		for (int bx = minx / blockSize; bx <= maxx / blockSize; bx++)
+		{
+			const int x0 = bx * blockSize, x1 = std::min(w, x0 + blockSize);
+			float farDepth = depth[x0 + by * blockSize * w];
+			for (int y = by * blockSize; y < y1; y++)
+			{
+				const float* r = row(y);
+				for (int x = x0; x < x1; x++) farDepth = std::min(farDepth, r[x]);
+			}
+			blockFar[bx + by * bw] = farDepth;
+		}
+	}
+}
+
+TGAImage DepthBuffer::toImage() const
+{
+	TGAImage image(w, h, TGAImage::GRAYSCALE);
+	for (int y = 0; y < h; y++)
+	{
+		for (int x = 0; x < w; x++)
+		{
+			float zNorm = (get(x, y) + 1.0f) * 0.5f; // Normalize z to [0, 1] range
+			std::uint8_t zValue = static_cast<std::uint8_t>(std::clamp(zNorm * 255.0f, 0.0f, 255.0f));
+			image.set(x, y, { zValue, zValue, zValue, 255 });
+		}
+	}
+	return image;
+}
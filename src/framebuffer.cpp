@@ -0,0 +1,13 @@
+#include <framebuffer.h>
+
+FrameBuffer::FrameBuffer(const int w, const int h, const TGAImage::Format format)
+	: w(w), h(h), bpp(static_cast<std::uint8_t>(format)),
+	  pixels(static_cast<std::uint32_t*>(::operator new[](static_cast<std::size_t>(w) * h * sizeof(std::uint32_t), std::align_val_t(alignment))))
+{
+	clear();
+}
+
+void FrameBuffer::clear(const std::uint32_t color)
+{
+	std::fill(pixels.get(), pixels.get() + static_cast<std::size_t>(w) * h, color);
+}
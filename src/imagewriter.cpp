@@ -0,0 +1,73 @@
+#include <imagewriter.h>
+#include <algorithm>
+#include <profiler.h>
+
+ImageWriter::ImageWriter(const std::size_t capacity) : capacity(std::max<std::size_t>(capacity, 1)), worker(&ImageWriter::run, this)
+{
+}
+
+ImageWriter::~ImageWriter()
+{
+	flush();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	changed.notify_all();
+	worker.join();
+}
+
+void ImageWriter::submit(TGAImage&& image, std::string filename)
+{
+	push({ std::move(image), std::move(filename) });
+}
+
+void ImageWriter::submit(FrameBuffer&& image, std::string filename)
+{
+	push({ std::move(image), std::move(filename) });
+}
+
+void ImageWriter::push(Job&& job)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (queue.size() >= capacity)
+	{
+		ScopedTimer timer(Stage::OutputWait); // Rendering is ahead of the disk
+		changed.wait(lock, [&] { return queue.size() < capacity; });
+	}
+	queue.push_back(std::move(job));
+	lock.unlock();
+	changed.notify_all();
+}
+
+bool ImageWriter::flush()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	changed.wait(lock, [&] { return queue.empty() && !busy; });
+	const bool ok = failures == 0;
+	failures = 0;
+	return ok;
+}
+
+void ImageWriter::run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		changed.wait(lock, [&] { return stopping || !queue.empty(); });
+		if (queue.empty()) return; // Only reached when stopping, the destructor flushed first
+		Job job = std::move(queue.front());
+		queue.pop_front();
+		busy = true;
+		lock.unlock();
+		changed.notify_all(); // Room for a blocked submit()
+
+		const bool written = std::visit([&](const auto& image) { return image.write_tga_file(job.filename); }, job.image);
+		job = {}; // Free the pixels before waiting for the next one
+
+		lock.lock();
+		busy = false;
+		if (!written) failures++;
+		changed.notify_all();
+	}
+}
@@ -1,5 +1,5 @@
-#include <tgaimage.h>
-#include <numbers>
+#include <renderer.h>
+#include <camera.h>
 #include <cstdlib>
 #include <ctime>
 #include <chrono>
@@ -9,345 +9,408 @@
 #include <fstream>
 #include <string>
 #include <geometry.h>
+#include <meshcache.h>
 #include <model.h>
+#include <parallel.h>
+#include <profiler.h>
+#include <depthbuffer.h>
+#include <imagewriter.h>
+#include <rasterizer.h>
+#include <shader.h>
+#include <streaming.h>
+#include <texture.h>
+#include <vertexstage.h>
+#include <wireframe.h>
 #include <algorithm>
+#include <iomanip>
+#include <optional>
 
 constexpr int width = 800;
 constexpr int height = 800;
 
-// BGRA order
-constexpr TGAColor white = { 255, 255, 255, 255 };
-constexpr TGAColor green = { 0, 255, 0, 255 };
-constexpr TGAColor red = { 0, 0, 255, 255 };
-constexpr TGAColor blue = { 255, 128, 64, 255 };
-constexpr TGAColor yellow = { 0, 200, 255, 255 };
-
-struct Camera
+// Check if the model is loaded correctly
+bool checkModel(const Model& model, const char* filename)
 {
-	vec3 eye = { -1, 0, 2 }; // Camera position in 3D space
-	vec3 center = { 0, 0, 0 }; // Point the camera is looking at
-	vec3 up = { 0, 1, 0 }; // Up direction of the camera
-	double fov = std::numbers::pi / 4; // Field of view in radians
-};
-
-Camera camera;
-mat<4, 4> ModelView, Perspective, Viewport;
+	if (filename == nullptr)
+	{
+		std::cerr << "Error: No model file provided";
+		return false;
+	}
+	if (model.nverts() == 0 || model.nfaces() == 0) // Check if model is empty/loaded correctly
+	{
+		std::cerr << "Error: Model failed to load or is empty. File: " << filename << "\n";
+		return false;
+	}
+	return true;
+}
 
-void lookAt(const vec3 eye, const vec3 center, const vec3 up)
+// A texture only applies to models with texture coordinates, say so rather than silently leaving it out
+void checkTexture(const Model& model, const Texture& texture)
 {
-	vec3 n = normalized(eye - center);
-	vec3 l = normalized(cross(up, n));
-	vec3 m = normalized(cross(n, l));
-	ModelView = mat<4, 4>{{{l.x, l.y, l.z, 0}, {m.x, m.y, m.z, 0}, {n.x, n.y, n.z, 0}, {0, 0, 0, 1}}} *
-				mat<4, 4>{{{1, 0, 0, -center.x}, { 0, 1, 0, -center.y }, { 0, 0, 1, -center.z }, { 0, 0, 0, 1 }}};
+	if (!texture.empty() && !model.hasUVs())
+	{
+		std::cerr << "Warning: the model has no texture coordinates, the texture is not used.\n";
+	}
 }
 
-void perspective(const double f)
+// --stats / --trace output, false if the trace could not be written
+bool report(const bool printStats, const std::string& traceFile, const double wallMs)
 {
-	Perspective = {{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, -1/f, 1}}};
+	if (printStats)
+	{
+		std::cout << "\n";
+		printProfile(std::cout, wallMs);
+	}
+	return traceFile.empty() || writeChromeTrace(traceFile);
 }
 
-void viewport(const int x, const int y, const int w, const int h)
+// --shader name, nothing for an unknown one
+std::optional<ShaderKind> parseShader(const std::string_view name)
 {
-	Viewport = { {{w / 2., 0, 0, x + w / 2.}, {0, h / 2., 0, y + h / 2.}, {0, 0, 1, 0}, {0, 0, 0, 1}} };
+	if (name == "flat") return ShaderKind::Flat;
+	if (name == "gouraud") return ShaderKind::Gouraud;
+	if (name == "phong") return ShaderKind::Phong;
+	if (name == "normals") return ShaderKind::Normals;
+	if (name == "depth") return ShaderKind::Depth;
+	if (name == "texture") return ShaderKind::Texture;
+	return std::nullopt;
 }
 
-
-void line(int ax, int ay, int bx, int by, TGAImage& frameBuffer, TGAColor color)
+// "triangleOutput.tga" becomes "triangleOutput_0007.tga" for the 8th view of a --views batch
+std::string numberedName(const std::string& base, const int index)
 {
-	bool steep = std::abs(ax - bx) < std::abs(ay - by);
-	if (steep) // if the line is steep, we transpose the coordinates
-	{
-		std::swap(ax, ay);
-		std::swap(bx, by);
-	}
-
-	if (ax > bx)
-	{
-		std::swap(ax, bx);
-		std::swap(ay, by);
-	}
+	std::ostringstream name;
+	name << base << '_' << std::setw(4) << std::setfill('0') << index << ".tga";
+	return name.str();
+}
 
-	int y = ay;
-	int ierror = 0;
-	for (int x = ax; x <= bx; x++)
+// --views: renders every camera of the list with the model loaded once. Views run side by side, each
+// with its own matrices, buffers and output file; threads left over when there are few views go to the tiles.
+// Finished images go to a background writer, so encoding overlaps with rendering the next views.
+bool renderViews(const Model& model, const std::vector<Camera>& cameras, Shading shading, const bool wireframe, const bool writeDepth, const unsigned threads, const RasterOptions& rasterOptions, RasterStats& rasterStats)
+{
+	const int nviews = static_cast<int>(cameras.size());
+	const unsigned viewThreads = std::min(threads, static_cast<unsigned>(nviews));
+	const unsigned tileThreads = std::max(1u, threads / viewThreads);
+	const EdgeList edges = wireframe ? buildEdges(model.indices(), model.nverts(), threads) : EdgeList(); // Shared by every view
+	const std::vector<TGAColor> colors = wireframe || (shading.kind != ShaderKind::Flat && shading.kind != ShaderKind::Texture) ? std::vector<TGAColor>() : randomFaceColors(model.nfaces()); // Every view gets the same face colors
+	if (shading.colors.empty()) shading.colors = colors;
+
+	ImageWriter writer(viewThreads + 2); // One image in flight per render worker and a couple queued, bounds the memory
+	std::vector<RasterStats> viewStats(nviews);
+	parallelFor(nviews, viewThreads, [&](const int v)
 	{
-		if (steep)
+		const View view = makeView(cameras[v], width, height);
+		FrameBuffer frameBuffer(width, height);
+		ScreenVertices screen;
+		transformVertices(model.positions(), view.transform(), width, height, screen, tileThreads, rasterOptions.mode == RasterMode::Simd, rasterOptions.subpixel ? subpixelBits : 0);
+		if (wireframe)
 		{
-			frameBuffer.set(y, x, color);
-		}
-		else
-		{
-			frameBuffer.set(x, y, color);
+			renderWireframe(model, edges, screen, frameBuffer, tileThreads);
+			writer.submit(std::move(frameBuffer), numberedName("frameBufferOutput", v));
+			return;
 		}
 
-		ierror += 2 * std::abs(by - ay);
-		if (ierror > bx - ax)
+		DepthBuffer zBuffer(width, height);
+		renderFaces(model, view, screen, shading, zBuffer, frameBuffer, tileThreads, rasterOptions, viewStats[v]);
+		writer.submit(std::move(frameBuffer), numberedName("triangleOutput", v));
+		if (writeDepth)
 		{
-			y += by > ay ? 1 : -1;
-			ierror -= 2 * (bx - ax);
+			writer.submit(zBuffer.toImage(), numberedName("zBufferOutput", v));
 		}
-	}
-}
-
-// Calculate signed area of triangle using determinant method
-double signedTriangleArea(int ax, int ay, int bx, int by, int cx, int cy)
-{
-	return .5 * ((by - ay) * (bx + ax) + (cy - by) * (cx + bx) + (ay - cy) * (ax + cx));
+	});
 
+	for (const RasterStats& stats : viewStats) rasterStats += stats;
+	return writer.flush();
 }
 
-void triangle(int ax, int ay, int az, int bx, int by, int bz, int cx, int cy, int cz, TGAImage& zBuffer, TGAImage& frameBuffer, TGAColor color, const vec3& v0, const vec3& v1, const vec3& v2)
+int main(int argc, char** argv)
 {
-	// Backface culling: Calculating triangle normal
-	vec3 edge1 = v1 - v0;
-	vec3 edge2 = v2 - v0;
-	vec3 normal = cross(edge1, edge2);
-	
-	// Camera direction assuming is at origin looking down the negative Z-axis
-	vec3 triangleCenter = (v0 + v1 + v2) / 3.0;
-	vec3 cameraDir = normalized(camera.eye - triangleCenter);
-
-	// If dot product is negative, triangle is facing away from camera
-	// Based on the angle between the triangle normal and camera direction we can determine visibility
-	if (normal * cameraDir <= 0)
+	auto start = std::chrono::high_resolution_clock::now();
+
+	if (argc < 3)
 	{
-		return; // Backface culling: Skip triangle if facing away from camera
+		std::cerr << "Usage: " << argv[0] << " --wireframe <model.obj> or --faces <model.obj> [--threads N] [--seed N] [--raster scalar|simd] [--no-hiz] [--no-clusters] [--subpixel] [--shader flat|gouraud|phong|normals|depth|texture] [--texture diffuse.tga] [--filter nearest|bilinear] [--no-mipmaps] [--zbuffer] [--no-cache] [--verify-cache] [--reorder none|faces|all] [--weld EPSILON] [--stream] [--stream-chunk FACES] [--views cameras.txt] [--stats] [--trace out.json]\n";
+		return EXIT_FAILURE;
 	}
 
-	// Use bounding box approach to limit the area we need to scan
-	int bbminx = std::max(0, std::min({ ax, bx, cx }));
-	int bbminy = std::max(0, std::min({ ay, by, cy }));
-	int bbmaxx = std::min(width - 1, std::max({ ax, bx, cx }));
-	int bbmaxy = std::min(height - 1, std::max({ ay, by, cy }));
-
-	// Calculate total triange area for barycentric coordinates
-	vec3 v0v1 = { bx - ax, by - ay, 0 };
-	vec3 v0v2 = { cx - ax, cy - ay, 0 };
-	double totalArea = 0.5 * std::abs(cross(v0v1, v0v2).z);
-	if (totalArea < 1e-6) return; // Degenerate triangle, skip rendering
-
-	for (int x = bbminx; x <= bbmaxx; x++)
+	unsigned threads = defaultThreadCount();
+	unsigned seed = static_cast<unsigned>(time(nullptr));
+	RasterOptions rasterOptions;
+	bool writeDepth = false;
+	ModelLoadOptions modelOptions;
+	bool printStats = false;
+	std::string traceFile;
+	std::string cameraList;
+	std::string textureFile;
+	std::string_view shaderName;
+	bool stream = false;
+	StreamOptions streamOptions;
+	for (int i = 3; i < argc; i++)
 	{
-		for (int y = bbminy; y <= bbmaxy; y++)
+		std::string_view option(argv[i]);
+		if (option == "--threads" && i + 1 < argc)
 		{
-			// Calculate barycentric coordinates
-			vec3 pv1 = { bx - x, by - y, 0 };
-			vec3 pv2 = { cx - x, cy - y, 0 };
-			double alpha = signedTriangleArea(x, y, bx, by, cx, cy) / totalArea;
-
-			vec3 v0p = { x - ax, y - ay, 0 };
-			vec3 v0v2Area = { cx - x, cy - y, 0 };
-			double beta = 0.5 * std::abs(cross(v0p, v0v2Area).z / totalArea);
-			double gamma = 1.0 - alpha - beta;
-
-			// Check if pixel is inside triangle
-			if (alpha < 0 || beta < 0 || gamma < 0) continue;
-
-			// Interpolate Z-coordinate using barycentric coordinates
-			double z = alpha * az + beta * bz + gamma * cz;
-
-			// Z-buffer test (assuming higer Z values are closer to camera)
-			TGAColor currentZ = zBuffer.get(x, y);
-			double zNorm = (z + 1) / 2; // Normalize z to [0, 1] range
-			unsigned char zValue = static_cast<unsigned char>(std::clamp(zNorm * 255, 0.0, 255.0));
-
-			if (zValue > currentZ[0]) // Closer to camera
+			threads = std::max(1, std::atoi(argv[++i])); // 1 = the original single-threaded loop
+		}
+		else if (option == "--seed" && i + 1 < argc)
+		{
+			seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10)); // Fixed seed gives reproducible colors to compare runs
+		}
+		else if (option == "--raster" && i + 1 < argc)
+		{
+			std::string_view name(argv[++i]);
+			if (name != "scalar" && name != "simd")
 			{
-				// Store depth in grayscale z-buffer
-				zBuffer.set(x, y, { zValue, zValue, zValue, 255 });
-				frameBuffer.set(x, y, color);
+				std::cerr << "Unknown raster mode: " << name << " Use 'scalar' or 'simd'.\n";
+				return EXIT_FAILURE;
 			}
+			rasterOptions.mode = name == "scalar" ? RasterMode::Scalar : RasterMode::Simd; // Both give the same image, scalar is kept to compare
+		}
+		else if (option == "--no-hiz")
+		{
+			rasterOptions.hiZ = false; // Same image, only slower, useful to measure what the coarse depth test saves
+		}
+		else if (option == "--no-clusters")
+		{
+			rasterOptions.clusterCulling = false; // Test every face on its own, same image
+		}
+		else if (option == "--subpixel")
+		{
+			rasterOptions.subpixel = true; // 28.4 fixed point vertices and a top-left fill rule, shared edges are drawn exactly once
+		}
+		else if (option == "--shader" && i + 1 < argc)
+		{
+			shaderName = argv[++i]; // How --faces colors the faces, flat random colors unless asked (texture with --texture)
+			if (!parseShader(shaderName))
+			{
+				std::cerr << "Unknown shader: " << shaderName << " Use 'flat', 'gouraud', 'phong', 'normals', 'depth' or 'texture'.\n";
+				return EXIT_FAILURE;
+			}
+		}
+		else if (option == "--texture" && i + 1 < argc)
+		{
+			textureFile = argv[++i]; // Diffuse map for --faces, used when the model has texture coordinates
+		}
+		else if (option == "--filter" && i + 1 < argc)
+		{
+			std::string_view name(argv[++i]);
+			if (name != "nearest" && name != "bilinear")
+			{
+				std::cerr << "Unknown texture filter: " << name << " Use 'nearest' or 'bilinear'.\n";
+				return EXIT_FAILURE;
+			}
+			rasterOptions.filter = name == "nearest" ? TextureFilter::Nearest : TextureFilter::Bilinear;
+		}
+		else if (option == "--no-mipmaps")
+		{
+			rasterOptions.mipmaps = false; // Always sample the full size texture, shows the aliasing the mip chain removes
+		}
+		else if (option == "--zbuffer")
+		{
+			writeDepth = true; // Also write zBufferOutput.tga
+		}
+		else if (option == "--no-cache")
+		{
+			modelOptions.cache = false; // Always parse the OBJ, and leave no .mcache file behind
+		}
+		else if (option == "--verify-cache")
+		{
+			modelOptions.verifyCache = true; // Range check every index of the mesh cache before using it, a pass over the whole file
+		}
+		else if (option == "--reorder" && i + 1 < argc)
+		{
+			std::string_view name(argv[++i]);
+			if (name != "none" && name != "faces" && name != "all")
+			{
+				std::cerr << "Unknown reorder mode: " << name << " Use 'none', 'faces' or 'all'.\n";
+				return EXIT_FAILURE;
+			}
+			// Vertex cache order for the faces, and with 'all' the vertices renumbered to match. 'none' keeps the file order.
+			modelOptions.order = name == "none" ? MeshOrder::File : name == "faces" ? MeshOrder::Faces : MeshOrder::FacesAndVertices;
+		}
+		else if (option == "--weld" && i + 1 < argc)
+		{
+			modelOptions.weld = true; // Merge vertices closer than this (0 merges exact duplicates only), positions may then also be quantized within half of it
+			modelOptions.weldEpsilon = std::max(0.0f, std::strtof(argv[++i], nullptr));
+		}
+		else if (option == "--stream")
+		{
+			stream = true; // --faces from the mesh cache in chunks, with memory bounded by the chunk size rather than the mesh
+		}
+		else if (option == "--stream-chunk" && i + 1 < argc)
+		{
+			streamOptions.chunkFaces = static_cast<std::uint32_t>(std::max(1l, std::atol(argv[++i]))); // Faces per --stream chunk
+		}
+		else if (option == "--views" && i + 1 < argc)
+		{
+			cameraList = argv[++i]; // One camera per line, renders them all into numbered files
+		}
+		else if (option == "--stats")
+		{
+			printStats = true; // Per-stage timings and work counters after the run
+		}
+		else if (option == "--trace" && i + 1 < argc)
+		{
+			traceFile = argv[++i]; // Chrome trace-event JSON, open in chrome://tracing or ui.perfetto.dev
+		}
+		else
+		{
+			std::cerr << "Unknown option: " << option << "\n";
+			return EXIT_FAILURE;
 		}
 	}
+	srand(seed); // Seed random number generator
+	if (printStats || !traceFile.empty()) enableProfiling(!traceFile.empty());
+	modelOptions.threads = threads;
 
-	// Scanline fill algorithm
-	// Process each horizontal line from top vertex to bottom vertex
-	// For each horizontal line, find intersections with triangle edges
-  //  for (int y = ay; y <= cy; y++)
-  //  {
-		//// Collect intersections of the scanline with triangle edges
-  //      std::vector<int> intersections;
-  //      
-		//// Define edges of the triangle
-  //      int edges[3][4] = {
-		//	{ax, ay, bx, by},
-		//	{bx, by, cx, cy},
-		//	{cx, cy, ax, ay}
-		//};
-  //      
-  //      for (int i = 0; i < 3; i++)
-  //      {
-  //          int x1 = edges[i][0], y1 = edges[i][1];
-  //          int x2 = edges[i][2], y2 = edges[i][3];
-  //          
-  //          // Check if scanline intersects this edge (avoid horizontal edges)
-  //          if (y1 != y2 && ((y1 < y && y2 >= y) || (y2 < y && y1 >= y)))
-  //          {
-  //              int xIntersect = x1 + (y - y1) * (x2 - x1) / (y2 - y1);
-  //              intersections.push_back(xIntersect);
-  //          }
-  //      }
-  //      
-  //      // Sort intersections and fill between pairs
-  //      if (intersections.size() >= 2)
-  //      {
-  //          std::sort(intersections.begin(), intersections.end());
-  //          int xMin = intersections[0];
-  //          int xMax = intersections[intersections.size() - 1];
-  //          
-  //          // Fill the scanline within screen bounds
-  //          for (int x = std::max(0, xMin); x <= std::min(width - 1, xMax); x++)
-  //          {
-  //              frameBuffer.set(x, y, color);
-  //          }
-  //      }
-  //  }
-}
-// Rotate vector around Y-axis by 60 degrees. Making the model spin around Y-axis
-//vec3 rot(vec3 vector)
-//{
-//	constexpr double angle = std::numbers::pi / 6; // Rotation angle in radians
-//	double cosAngle = std::cos(angle);
-//	double singAngle = std::sin(angle);
-//
-//	mat<3, 3> Ry;
-//	Ry[0][0] = cosAngle; Ry[0][1] = 0; Ry[0][2] = singAngle;
-//	Ry[1][0] = 0;        Ry[1][1] = 1; Ry[1][2] = 0;
-//	Ry[2][0] = -singAngle; Ry[2][1] = 0; Ry[2][2] = cosAngle;
-//
-//
-//	return Ry * vector; // Rotate around Y-axis
-//}
-
-
-// Project 3D coordinates to 2D screen space orthographic projection
-std::tuple<int, int, double> project(const vec4& vector)
-{
-	vec4 ndc = vector / vector.w; // Prespective divide
-	vec4 screen = Viewport * ndc; // Screen space coordinates
-	return { static_cast<int>(screen.x), static_cast<int>(screen.y), ndc.z }; // Return NDC z for depth testing
-}
-
-// Check if the model is loaded correctly
-bool checkModel(const Model& model, const char* filename)
-{
-	if (filename == nullptr)
+	std::vector<Camera> cameras;
+	if (!cameraList.empty() && !loadCameras(cameraList, cameras))
 	{
-		std::cerr << "Error: No model file provided";
-		return false;
-	}
-	if (model.nverts() == 0 || model.nfaces() == 0) // Check if model is empty/loaded correctly
-	{
-		std::cerr << "Error: Model failed to load or is empty. File: " << filename << "\n";
-		return false;
+		return EXIT_FAILURE;
 	}
-	return true;
-}
-
-int main(int argc, char** argv)
-{
-	auto start = std::chrono::high_resolution_clock::now();
-	srand(time(nullptr)); // Seed random number generator
 
-	if (argc < 3)
+	Texture texture;
+	if (!textureFile.empty() && !texture.load(textureFile))
 	{
-		std::cerr << "Usage: " << argv[0] << " --wireframe <model.obj> or --faces <model.obj>\n";
+		std::cerr << "Error: could not load texture " << textureFile << "\n";
 		return EXIT_FAILURE;
 	}
+	Shading shading;
+	shading.kind = !shaderName.empty() ? *parseShader(shaderName) : texture.empty() ? ShaderKind::Flat : ShaderKind::Texture;
+	shading.texture = texture.empty() ? nullptr : &texture;
 
 	// Initialize camera and projection matrices
-	lookAt(camera.eye, camera.center, camera.up);
-	perspective(1.0 / std::tan(camera.fov / 2.0)); // Perspective projection matrix
-	viewport(width / 16, height / 16, width * 7 / 8, height * 7 / 8); // Viewport transformation matrix
+	const View view = makeView(Camera(), width, height);
+	const mat<4, 4> viewportProjectionModelView = view.transform(); // Built once, applied to every vertex
 
 	const std::string filename = argv[2];
 	std::string_view argv1(argv[1]);
+	if (stream && (argv1 != "--faces" || !cameras.empty() || !modelOptions.cache))
+	{
+		std::cerr << "--stream renders one view of --faces from the mesh cache, it cannot be combined with --views or --no-cache.\n";
+		return EXIT_FAILURE;
+	}
+	if (stream && shading.kind != ShaderKind::Flat && shading.kind != ShaderKind::Depth)
+	{
+		std::cerr << "--stream reads positions only, it works with the flat and depth shaders (no --texture).\n";
+		return EXIT_FAILURE;
+	}
 
-	if (argv1 == "--wireframe")
+	if (!cameras.empty() && (argv1 == "--wireframe" || argv1 == "--faces"))
 	{
-		Model model(filename);
+		Model model(filename, modelOptions);
 		if (!checkModel(model, filename.c_str())) // Check if model is empty/loaded correctly
 		{
 			return EXIT_FAILURE;
 		}
+		checkTexture(model, texture);
 
-		TGAImage frameBuffer(width, height, TGAImage::RGB);
-
-		// Draw all triangles edges from faces
-		for (int i = 0; i < model.nfaces(); i++)
+		RasterStats rasterStats;
+		const bool written = renderViews(model, cameras, shading, argv1 == "--wireframe", writeDepth, threads, rasterOptions, rasterStats);
+		std::cout << "Drew " << cameras.size() << " views.\n";
+		if (argv1 == "--faces" && rasterOptions.hiZ)
 		{
-			vec4 clip[3];
-			for (int d = 0; d < 3; d++)
-			{
-				vec3 v = model.vert(i, d);
-				clip[d] = Perspective * ModelView * vec4{ v.x, v.y, v.z, 1.0 };
-			}
-			auto [ax, ay, az] = project(clip[0]);
-			auto [bx, by, bz] = project(clip[1]);
-			auto [cx, cy, cz] = project(clip[2]);
-
-			// Draw edges of the triangle
-			line(ax, ay, bx, by, frameBuffer, red);
-			line(bx, by, cx, cy, frameBuffer, red);
-			line(cx, cy, ax, ay, frameBuffer, red);
+			std::cout << "Hi-Z culled " << rasterStats.hiZTriangles << " of " << model.nfaces() * cameras.size() << " triangles, " << rasterStats.hiZPixels << " pixels\n";
 		}
 
-		// Draw vertices as white dots
-		for (int i = 0; i < model.nverts(); i++)
+		auto end = std::chrono::high_resolution_clock::now();
+		auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+		std::cout << "Rendered in " << elapsed.count() << " ms\n";
+		if (!report(printStats, traceFile, std::chrono::duration<double, std::milli>(end - start).count())) return EXIT_FAILURE;
+		return written ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if (argv1 == "--wireframe")
+	{
+		Model model(filename, modelOptions);
+		if (!checkModel(model, filename.c_str())) // Check if model is empty/loaded correctly
 		{
-			vec3 v = model.vert(i);
-			vec4 clip = Perspective * ModelView * vec4{ v.x, v.y, v.z , 1.0 };
-			auto [x, y, z] = project(clip);
-			frameBuffer.set(x, y, white); // Draw vertex as white dot
+			return EXIT_FAILURE;
 		}
 
+		FrameBuffer frameBuffer(width, height);
+
+		// Every vertex is transformed once, faces only look their corners up
+		ScreenVertices screen;
+		transformVertices(model.positions(), viewportProjectionModelView, width, height, screen, threads, rasterOptions.mode == RasterMode::Simd, rasterOptions.subpixel ? subpixelBits : 0);
+		renderWireframe(model, buildEdges(model.indices(), model.nverts(), threads), screen, frameBuffer, threads);
+
 		frameBuffer.write_tga_file("frameBufferOutput.tga");
 
 		auto end = std::chrono::high_resolution_clock::now();
 		auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 		std::cout << "Rendered in " << elapsed.count() << " ms\n";
+		if (!report(printStats, traceFile, std::chrono::duration<double, std::milli>(end - start).count())) return EXIT_FAILURE;
 
 		return EXIT_SUCCESS;
 
 	}
+	else if (argv1 == "--faces" && stream)
+	{
+		{
+			Model model(filename, modelOptions); // Maps the cache without reading it, or parses the OBJ once to write it
+			if (!checkModel(model, filename.c_str())) return EXIT_FAILURE;
+		}
+
+		FrameBuffer frameBuffer(width, height);
+		DepthBuffer zBuffer(width, height);
+		RasterStats rasterStats;
+		StreamStats streamStats;
+		if (!renderStreamed(filename, view, shading, zBuffer, frameBuffer, threads, rasterOptions, streamOptions, rasterStats, streamStats))
+		{
+			std::cerr << "Error: could not stream " << meshCachePath(filename) << "\n";
+			return EXIT_FAILURE;
+		}
+		frameBuffer.write_tga_file("triangleOutput.tga");
+		if (writeDepth)
+		{
+			zBuffer.toImage().write_tga_file("zBufferOutput.tga");
+		}
+		std::cout << "Image drawn from " << streamStats.chunks << " chunks, " << streamStats.vertices << " vertices and " << streamStats.bytes / (1024.0 * 1024.0)
+			<< " MB read, largest chunk " << streamStats.peakChunkBytes / (1024.0 * 1024.0) << " MB, " << streamStats.waitMs << " ms waiting for reads.\n";
+
+		auto end = std::chrono::high_resolution_clock::now();
+		auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+		std::cout << "Rendered in " << elapsed.count() << " ms\n";
+		if (!report(printStats, traceFile, std::chrono::duration<double, std::milli>(end - start).count())) return EXIT_FAILURE;
+		return EXIT_SUCCESS;
+	}
 	else if (argv1 == "--faces")
 	{
-		Model model(filename);
+		Model model(filename, modelOptions);
 		if (!checkModel(model, filename.c_str())) // Check if model is empty/loaded correctly
 		{
 			return EXIT_FAILURE;
 		}
+		checkTexture(model, texture);
 
-		TGAImage frameBuffer(width, height, TGAImage::RGB);
-		TGAImage zBuffer(width, height, TGAImage::GRAYSCALE);
-
-		for (int i = 0; i < model.nfaces(); i++) // Iterating through all faces
-		{
-			vec4 clip[3];
-			vec3 world[3];
-			for (int d = 0; d < 3; d++)
-			{
-				world[d] = model.vert(i, d);
-				clip[d] = Perspective * ModelView * vec4{ world[d].x, world[d].y, world[d].z, 1.0 };
-			}
+		FrameBuffer frameBuffer(width, height);
+		DepthBuffer zBuffer(width, height);
+		RasterStats rasterStats;
 
-			// Project the vertices to 2D screen space
-			auto [ax, ay, az] = project(clip[0]);
-			auto [bx, by, bz] = project(clip[1]);
-			auto [cx, cy, cz] = project(clip[2]);
+		// Every vertex is transformed once, faces only look their corners up
+		ScreenVertices screen;
+		transformVertices(model.positions(), viewportProjectionModelView, width, height, screen, threads, rasterOptions.mode == RasterMode::Simd, rasterOptions.subpixel ? subpixelBits : 0);
 
-			TGAColor randomColor = { rand() % 256, rand() % 256, rand() % 256, 255 };
-			// Draw triangle using barycentric coordinates
-			triangle(ax, ay, az, bx, by, bz, cx, cy, cz, zBuffer, frameBuffer, randomColor, world[0], world[1], world[2]);
-		}
+		const std::vector<TGAColor> colors = shading.kind == ShaderKind::Flat || shading.kind == ShaderKind::Texture ? randomFaceColors(model.nfaces()) : std::vector<TGAColor>();
+		shading.colors = colors;
+		renderFaces(model, view, screen, shading, zBuffer, frameBuffer, threads, rasterOptions, rasterStats);
 		frameBuffer.write_tga_file("triangleOutput.tga");
-		zBuffer.write_tga_file("zBufferOutput.tga");
+		if (writeDepth)
+		{
+			zBuffer.toImage().write_tga_file("zBufferOutput.tga"); // Only pay for the 8-bit conversion when asked for
+		}
 		std::cout << "Image drawn.\n";
+		if (rasterOptions.hiZ)
+		{
+			std::cout << "Hi-Z culled " << rasterStats.hiZTriangles << " of " << model.nfaces() << " triangles, " << rasterStats.hiZPixels << " pixels\n";
+		}
 
 		auto end = std::chrono::high_resolution_clock::now();
 		auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 		std::cout << "Rendered in " << elapsed.count() << " ms\n";
+		if (!report(printStats, traceFile, std::chrono::duration<double, std::milli>(end - start).count())) return EXIT_FAILURE;
 		return EXIT_SUCCESS;
 
 	}
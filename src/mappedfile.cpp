@@ -0,0 +1,67 @@
+#include <mappedfile.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& filename)
+{
+	file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		file = nullptr;
+		return;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize)) return;
+	length = static_cast<std::size_t>(fileSize.QuadPart);
+	opened = true;
+	if (length == 0) return; // Empty files cannot be mapped, but they are valid (and empty)
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping) bytes = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	opened = bytes != nullptr;
+}
+
+MappedFile::~MappedFile()
+{
+	if (bytes) UnmapViewOfFile(bytes);
+	if (mapping) CloseHandle(mapping);
+	if (file) CloseHandle(file);
+}
+#else
+MappedFile::MappedFile(const std::string& filename)
+{
+	fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) return;
+	struct stat st;
+	if (fstat(fd, &st) != 0) return;
+	length = static_cast<std::size_t>(st.st_size);
+	opened = true;
+	if (length == 0) return; // Empty files cannot be mapped, but they are valid (and empty)
+
+	void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (p == MAP_FAILED)
+	{
+		opened = false;
+		return;
+	}
+	madvise(p, length, MADV_SEQUENTIAL); // We read front to back once, let the kernel read ahead aggressively
+	bytes = static_cast<const char*>(p);
+}
+
+MappedFile::~MappedFile()
+{
+	if (bytes) munmap(const_cast<char*>(bytes), length);
+	if (fd >= 0) close(fd);
+}
+#endif
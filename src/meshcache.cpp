@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <system_error>
+#include <meshcache.h>
+#include <model.h>
+
+namespace
+{
+	// Size and modification time of the OBJ, the cache is stale as soon as either changes
+	bool sourceStamp(const std::string& objFilename, std::uint64_t& size, std::int64_t& time)
+	{
+		std::error_code ec;
+		size = std::filesystem::file_size(objFilename, ec);
+		if (ec) return false;
+		auto writeTime = std::filesystem::last_write_time(objFilename, ec);
+		if (ec) return false;
+		time = static_cast<std::int64_t>(writeTime.time_since_epoch().count());
+		return true;
+	}
+
+	// Arrays of 16 bit values end on a 4 byte boundary, so everything after them stays aligned
+	std::uint64_t padded(const std::uint64_t bytes)
+	{
+		return (bytes + 3) & ~std::uint64_t(3);
+	}
+
+	std::uint64_t positionBytes(const MeshCacheHeader& header)
+	{
+		return padded(header.nverts * 3 * (header.positionFormat == static_cast<std::uint32_t>(PositionFormat::Quantized16) ? sizeof(std::uint16_t) : sizeof(float)));
+	}
+
+	std::uint64_t indexBytes(const MeshCacheHeader& header)
+	{
+		return padded(header.nindices * (header.indexFormat == static_cast<std::uint32_t>(IndexFormat::UInt16) ? sizeof(std::uint16_t) : sizeof(std::uint32_t)));
+	}
+
+	// Whether `header`, from a cache file of fileSize bytes, is this version, matches the OBJ as it is now and adds up
+	bool usableHeader(const std::string& objFilename, const MeshCacheHeader& header, const std::uint64_t fileSize)
+	{
+		MeshCacheHeader expected;
+		if (!sourceStamp(objFilename, expected.sourceSize, expected.sourceTime)) return false;
+		if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != MeshCacheHeader::currentVersion ||
+			header.positionFormat > static_cast<std::uint32_t>(PositionFormat::Quantized16) || header.indexFormat > static_cast<std::uint32_t>(IndexFormat::UInt16) ||
+			header.sourceSize != expected.sourceSize || header.sourceTime != expected.sourceTime)
+		{
+			return false; // Other format, or the OBJ changed since the cache was written
+		}
+
+		const std::uint64_t uvIndices = header.nuvs ? header.nindices : 0, normalIndices = header.nnormals ? header.nindices : 0;
+		const std::uint64_t bytes = sizeof(header) + positionBytes(header) + indexBytes(header) + header.nclusters * sizeof(Cluster) + header.nindices / 3 * sizeof(std::uint32_t)
+			+ (std::uint64_t(header.nuvs) * 2 + std::uint64_t(header.nnormals) * 3) * sizeof(float) + (uvIndices + normalIndices) * sizeof(std::uint32_t);
+		return bytes == fileSize && header.nindices % 3 == 0; // Otherwise truncated or corrupt
+	}
+
+	// Whether every index in the arrays points into the array it indexes, as the parser checks them. The sizes add up
+	// for any cache usableHeader() accepts, this catches one that was corrupted in place or written by something else.
+	bool validIndices(const MeshCacheHeader& header, const MeshCacheArrays& arrays)
+	{
+		const std::uint64_t nfaces = header.nindices / 3;
+		auto below = [](const std::uint64_t count) { return [count](const std::uint32_t i) { return i < count; }; };
+		auto attribute = [](const std::uint64_t count) { return [count](const std::uint32_t i) { return i == Model::noAttribute || i < count; }; };
+		return std::all_of(arrays.indices.wide.begin(), arrays.indices.wide.end(), below(header.nverts))
+			&& std::all_of(arrays.indices.narrow.begin(), arrays.indices.narrow.end(), below(header.nverts))
+			&& std::all_of(arrays.clusters.begin(), arrays.clusters.end(), [&](const Cluster& c) { return std::uint64_t(c.first) + c.count <= nfaces; })
+			&& std::all_of(arrays.clusterFaces.begin(), arrays.clusterFaces.end(), below(nfaces))
+			&& std::all_of(arrays.uvIndices.begin(), arrays.uvIndices.end(), attribute(header.nuvs))
+			&& std::all_of(arrays.normalIndices.begin(), arrays.normalIndices.end(), attribute(header.nnormals));
+	}
+}
+
+std::string meshCachePath(const std::string& objFilename)
+{
+	return objFilename + ".mcache";
+}
+
+std::unique_ptr<MappedFile> openMeshCache(const std::string& objFilename, MeshCacheArrays& arrays, const bool verify)
+{
+	auto file = std::make_unique<MappedFile>(meshCachePath(objFilename));
+	if (!file->is_open() || file->size() < sizeof(MeshCacheHeader)) return nullptr;
+
+	MeshCacheHeader header;
+	std::memcpy(&header, file->data(), sizeof(header));
+	if (!usableHeader(objFilename, header, file->size())) return nullptr;
+	const std::uint64_t uvIndices = header.nuvs ? header.nindices : 0, normalIndices = header.nnormals ? header.nindices : 0;
+
+	arrays.ordering = { static_cast<MeshOrder>(header.order), header.acmrBefore, header.acmrAfter };
+	arrays.weldEpsilon = header.weldEpsilon;
+	// The mapping is page aligned and the header is 112 bytes, so all arrays can be used in place (they only need 4 byte alignment)
+	const char* data = file->data() + sizeof(header);
+	if (header.positionFormat == static_cast<std::uint32_t>(PositionFormat::Quantized16)) arrays.positions = { {}, { reinterpret_cast<const std::uint16_t*>(data), header.nverts * 3 }, header.grid };
+	else arrays.positions = { { reinterpret_cast<const float*>(data), header.nverts * 3 } };
+	data += positionBytes(header);
+	if (header.indexFormat == static_cast<std::uint32_t>(IndexFormat::UInt16)) arrays.indices = { {}, { reinterpret_cast<const std::uint16_t*>(data), header.nindices } };
+	else arrays.indices = { { reinterpret_cast<const std::uint32_t*>(data), header.nindices } };
+	data += indexBytes(header);
+	arrays.clusters = { reinterpret_cast<const Cluster*>(data), header.nclusters };
+	data += header.nclusters * sizeof(Cluster);
+	arrays.clusterFaces = { reinterpret_cast<const std::uint32_t*>(data), header.nindices / 3 };
+	data += header.nindices / 3 * sizeof(std::uint32_t);
+	arrays.uvs = { reinterpret_cast<const float*>(data), std::uint64_t(header.nuvs) * 2 };
+	data += arrays.uvs.size_bytes();
+	arrays.normals = { reinterpret_cast<const float*>(data), std::uint64_t(header.nnormals) * 3 };
+	data += arrays.normals.size_bytes();
+	arrays.uvIndices = { reinterpret_cast<const std::uint32_t*>(data), uvIndices };
+	data += arrays.uvIndices.size_bytes();
+	arrays.normalIndices = { reinterpret_cast<const std::uint32_t*>(data), normalIndices };
+#ifdef NDEBUG
+	const bool check = verify || !(header.flags & MeshCacheHeader::validated);
+#else
+	const bool check = true;
+#endif
+	if (check && !validIndices(header, arrays)) return nullptr;
+	return file;
+}
+
+bool writeMeshCache(const std::string& objFilename, const MeshCacheArrays& arrays)
+{
+	MeshCacheHeader header;
+	if (!sourceStamp(objFilename, header.sourceSize, header.sourceTime)) return false;
+	header.positionFormat = static_cast<std::uint32_t>(arrays.positions.format());
+	header.indexFormat = static_cast<std::uint32_t>(arrays.indices.format());
+	header.grid = arrays.positions.grid;
+	header.weldEpsilon = arrays.weldEpsilon;
+	header.nverts = arrays.positions.size();
+	header.nindices = arrays.indices.size();
+	header.nclusters = arrays.clusters.size();
+	header.nuvs = static_cast<std::uint32_t>(arrays.uvs.size() / 2);
+	header.nnormals = static_cast<std::uint32_t>(arrays.normals.size() / 3);
+	header.order = static_cast<std::uint32_t>(arrays.ordering.order);
+	header.acmrBefore = arrays.ordering.acmrBefore;
+	header.acmrAfter = arrays.ordering.acmrAfter;
+	header.flags = MeshCacheHeader::validated; // Models only hold indices loadObj() checked
+	assert(arrays.uvIndices.size() == (header.nuvs ? header.nindices : 0) && arrays.normalIndices.size() == (header.nnormals ? header.nindices : 0));
+	assert(validIndices(header, arrays));
+
+	const std::string path = meshCachePath(objFilename);
+	const std::string temporary = path + "." + std::to_string(std::random_device()()) + ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		const char zeros[4] = {};
+		out.write(static_cast<const char*>(arrays.positions.data()), arrays.positions.size_bytes());
+		out.write(zeros, static_cast<std::streamsize>(padded(arrays.positions.size_bytes()) - arrays.positions.size_bytes()));
+		out.write(static_cast<const char*>(arrays.indices.data()), arrays.indices.size_bytes());
+		out.write(zeros, static_cast<std::streamsize>(padded(arrays.indices.size_bytes()) - arrays.indices.size_bytes()));
+		out.write(reinterpret_cast<const char*>(arrays.clusters.data()), arrays.clusters.size_bytes());
+		out.write(reinterpret_cast<const char*>(arrays.clusterFaces.data()), arrays.clusterFaces.size_bytes());
+		out.write(reinterpret_cast<const char*>(arrays.uvs.data()), arrays.uvs.size_bytes());
+		out.write(reinterpret_cast<const char*>(arrays.normals.data()), arrays.normals.size_bytes());
+		out.write(reinterpret_cast<const char*>(arrays.uvIndices.data()), arrays.uvIndices.size_bytes());
+		out.write(reinterpret_cast<const char*>(arrays.normalIndices.data()), arrays.normalIndices.size_bytes());
+		if (!out.good())
+		{
+			out.close();
+			std::filesystem::remove(temporary);
+			std::cerr << "Warning: could not write mesh cache " << path << "\n";
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(temporary, path, ec);
+	if (ec)
+	{
+		std::filesystem::remove(temporary, ec);
+		return false;
+	}
+	return true;
+}
+
+bool MeshCacheStream::open(const std::string& objFilename)
+{
+	file = std::ifstream(meshCachePath(objFilename), std::ios::binary);
+	if (!file) return false;
+	file.seekg(0, std::ios::end);
+	const std::uint64_t size = static_cast<std::uint64_t>(file.tellg());
+	file.seekg(0);
+	if (size < sizeof(header) || !file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+	bytesRead = sizeof(header);
+	return usableHeader(objFilename, header, size);
+}
+
+bool MeshCacheStream::read(const std::uint64_t offset, const std::uint64_t bytes)
+{
+	buffer.resize(bytes);
+	file.seekg(static_cast<std::streamoff>(offset));
+	file.read(buffer.data(), static_cast<std::streamsize>(bytes));
+	bytesRead += bytes;
+	return file.good();
+}
+
+bool MeshCacheStream::readFaces(const std::uint64_t first, const std::uint64_t count, std::vector<std::uint32_t>& indices)
+{
+	if (first + count > nfaces()) return false;
+	const bool narrow = header.indexFormat == static_cast<std::uint32_t>(IndexFormat::UInt16);
+	const std::uint64_t size = narrow ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+	if (!read(sizeof(header) + positionBytes(header) + first * 3 * size, count * 3 * size)) return false;
+	indices.resize(count * 3);
+	if (!narrow)
+	{
+		std::memcpy(indices.data(), buffer.data(), buffer.size());
+		return true;
+	}
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		std::uint16_t v;
+		std::memcpy(&v, buffer.data() + i * sizeof(v), sizeof(v));
+		indices[i] = v;
+	}
+	return true;
+}
+
+bool MeshCacheStream::readPositions(const std::uint64_t first, const std::uint64_t count, std::vector<float>& positions)
+{
+	if (first + count > nverts()) return false;
+	const bool quantized = header.positionFormat == static_cast<std::uint32_t>(PositionFormat::Quantized16);
+	const std::uint64_t size = quantized ? sizeof(std::uint16_t) : sizeof(float);
+	if (!read(sizeof(header) + first * 3 * size, count * 3 * size)) return false;
+	const size_t base = positions.size();
+	positions.resize(base + count * 3);
+	if (!quantized)
+	{
+		std::memcpy(positions.data() + base, buffer.data(), buffer.size());
+		return true;
+	}
+	for (size_t i = 0; i < count * 3; i++)
+	{
+		std::uint16_t q;
+		std::memcpy(&q, buffer.data() + i * sizeof(q), sizeof(q));
+		positions[base + i] = header.grid.decode(static_cast<int>(i % 3), q);
+	}
+	return true;
+}
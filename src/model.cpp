@@ -1,59 +1,512 @@
-#include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <mappedfile.h>
+#include <meshcache.h>
 #include <model.h>
+#include <parallel.h>
+#include <profiler.h>
+#include <vertexcache.h>
+#include <weld.h>
 
-
-Model::Model(const std::string filename)
+namespace
 {
-	std::ifstream file(filename);
+	// ACMR before and after reordering, and how long it took (negative when it was read from the mesh cache)
+	void printOrdering(const MeshOrderStats& ordering, const double milliseconds)
+	{
+		static constexpr const char* names[] = { "file order", "faces reordered", "faces and vertices reordered" };
+		std::cerr << "# ACMR " << ordering.acmrBefore << " -> " << ordering.acmrAfter << " (" << names[static_cast<int>(ordering.order)];
+		if (milliseconds >= 0) std::cerr << " in " << milliseconds << " ms)\n";
+		else std::cerr << ", cached)\n";
+	}
 
-	if (!file)
+	void printStorage(const PositionView& positions, const IndexView& indices)
 	{
-		std::cerr << "Error opening .obj file: " << filename << std::endl;
-		return;
+		const double megabytes = (positions.size_bytes() + indices.size_bytes()) / (1024.0 * 1024.0);
+		std::cerr << "# " << (positions.format() == PositionFormat::Quantized16 ? "16 bit quantized" : "float") << " positions, "
+			<< (indices.format() == IndexFormat::UInt16 ? 16 : 32) << " bit indices (" << megabytes << " MB)\n";
+	}
+
+	// The parser works directly on the mapped bytes, `p` always points into [p, end)
+	const char* skipSpaces(const char* p, const char* end)
+	{
+		while (p < end && (*p == ' ' || *p == '\t')) p++;
+		return p;
+	}
+
+	const char* nextLine(const char* p, const char* end)
+	{
+		const void* newline = std::memchr(p, '\n', end - p);
+		return newline ? static_cast<const char*>(newline) + 1 : end;
+	}
+
+	// Quick pass counting "v ", "vt", "vn" and "f " records so the vectors are allocated once
+	void countRecords(const char* p, const char* end, size_t& nverts, size_t& nuvs, size_t& nnormals, size_t& nfaces)
+	{
+		while (p < end)
+		{
+			if (end - p > 1 && p[1] == ' ')
+			{
+				nverts += p[0] == 'v';
+				nfaces += p[0] == 'f';
+			}
+			else if (end - p > 2 && p[0] == 'v' && p[2] == ' ')
+			{
+				nuvs += p[1] == 't';
+				nnormals += p[1] == 'n';
+			}
+			p = nextLine(p, end);
+		}
 	}
 
-	std::string line;
-	while (std::getline(file, line)) // Best practice to read line by line 
+	// Reads one face corner: v, v/t, v//n or v/t/n into the position, texture and normal index. Missing ones are left at 0.
+	const char* parseCorner(const char* p, const char* end, int (&index)[3], bool& ok)
 	{
-		std::istringstream iss(line); // String stream parses the lines and uses whitespace to separate words
-		char prefix;
-		if (line.starts_with("v ")) // We are not using the string stream, so we can check the whitespaces.
+		auto [next, ec] = std::from_chars(p, end, index[0]);
+		ok = ec == std::errc();
+		p = next;
+		for (int slash = 0; ok && slash < 2 && p < end && *p == '/'; slash++)
 		{
-			iss >> prefix;
-			vec3 vertex;
-			for (int i = 0; i < 3; i++) // 3 iterations because we expect 3 coordinates per vertex
+			p++;
+			if (p < end && (*p == '-' || (*p >= '0' && *p <= '9'))) // Texture index may be empty in v//n
 			{
-				iss >> vertex[i]; // Populating the struct vec3
+				auto [after, err] = std::from_chars(p, end, index[slash + 1]);
+				ok = err == std::errc();
+				p = after;
 			}
-			verts.push_back(vertex);
 		}
-		else if (line.starts_with("f ")) // Face
+		return p;
+	}
+
+	// Reads `count` floats of a v/vt/vn record, missing trailing ones become 0
+	const char* parseFloats(const char* q, const char* end, const int count, std::vector<float>& out)
+	{
+		for (int i = 0; i < count; i++)
 		{
-			iss >> prefix;
-			int vertexIndex, textureIndex, normalIndex;
-			int vertexCount = 0;
+			float value = 0;
+			q = skipSpaces(q, end);
+			q = std::from_chars(q, end, value).ptr;
+			out.push_back(value);
+		}
+		return q;
+	}
+
+	// Everything parsed from one newline-aligned slice of the file
+	struct ObjChunk
+	{
+		std::vector<float> verts = {}; // x, y, z per vertex
+		std::vector<float> uvs = {}; // u, v per texture coordinate
+		std::vector<float> normals = {}; // x, y, z per normal
+		std::vector<std::uint32_t> faceVert = {};
+		std::vector<std::uint32_t> faceUv = {}, faceNormal = {}; // Empty until a corner of the chunk has one, then parallel to faceVert
+		std::vector<size_t> relative = {}, relativeUv = {}, relativeNormal = {}; // Slots holding a negative OBJ index, still counted from this chunk's first record
+		const char* error = nullptr; // Parsing stopped here with this message, later chunks are dropped
+	};
 
-			while (iss >> vertexIndex >> prefix >> textureIndex >> prefix >> normalIndex)
+	// Appends the 0-based form of OBJ index `index` (0 when the corner has none) for corner `corner`, `count` records read so far
+	void addIndex(std::vector<std::uint32_t>& indices, std::vector<size_t>& relative, const int index, const size_t count, const size_t corner)
+	{
+		if (index == 0 && indices.empty()) return; // Nothing in this chunk uses the attribute yet
+		indices.resize(corner, Model::noAttribute); // Earlier corners without one
+		if (index < 0) // Counts back from the last record read so far, which may sit in an earlier chunk
+		{
+			relative.push_back(indices.size());
+			indices.push_back(static_cast<std::uint32_t>(static_cast<int>(count) + index)); // Wraps around when negative, fixed up after the merge
+		}
+		else
+		{
+			indices.push_back(index ? static_cast<std::uint32_t>(index - 1) : Model::noAttribute); // OBJ indices are 1-based, convert to 0-based
+		}
+	}
+
+	void parseChunk(const char* p, const char* end, ObjChunk& chunk)
+	{
+		size_t vertexCount = 0, uvCount = 0, normalCount = 0, faceCount = 0;
+		countRecords(p, end, vertexCount, uvCount, normalCount, faceCount);
+		chunk.verts.reserve(vertexCount * 3);
+		chunk.uvs.reserve(uvCount * 2);
+		chunk.normals.reserve(normalCount * 3);
+		chunk.faceVert.reserve(faceCount * 3);
+
+		for (; p < end; p = nextLine(p, end)) // Line by line, straight from the mapped bytes
+		{
+			const char* q = skipSpaces(p, end);
+			if (end - q > 2 && q[0] == 'v' && (q[2] == ' ' || q[2] == '\t'))
 			{
-				if (vertexIndex <= 0)
+				if (q[1] == 't') parseFloats(q + 3, end, 2, chunk.uvs); // A third (w) coordinate is ignored
+				else if (q[1] == 'n') parseFloats(q + 3, end, 3, chunk.normals);
+				continue;
+			}
+			if (end - q < 2 || (q[1] != ' ' && q[1] != '\t')) continue; // Comments, empty lines, groups...
+
+			if (q[0] == 'v')
+			{
+				parseFloats(q + 2, end, 3, chunk.verts); // 3 coordinates per vertex
+			}
+			else if (q[0] == 'f') // Face
+			{
+				const char* lineEnd = nextLine(q, end);
+				int cornerCount = 0;
+				q = skipSpaces(q + 2, lineEnd);
+				while (q < lineEnd && *q != '\n' && *q != '\r' && *q != '#')
+				{
+					int index[3] = {}; // Position, texture coordinate, normal
+					bool ok = false;
+					q = skipSpaces(parseCorner(q, lineEnd, index, ok), lineEnd);
+					if (!ok || index[0] == 0)
+					{
+						chunk.error = "Error: Invalid vertex index in face.\n";
+						return;
+					}
+
+					const size_t corner = chunk.faceVert.size();
+					addIndex(chunk.faceVert, chunk.relative, index[0], chunk.verts.size() / 3, corner);
+					addIndex(chunk.faceUv, chunk.relativeUv, index[1], chunk.uvs.size() / 2, corner);
+					addIndex(chunk.faceNormal, chunk.relativeNormal, index[2], chunk.normals.size() / 3, corner);
+					cornerCount++;
+				}
+
+				if (cornerCount != 3)
 				{
-					std::cerr << "Error: Invalid vertex index in face.\n";
+					chunk.error = "Error: Only triangulated .obj files are supported.\n";
 					return;
 				}
-				face_vert.push_back(vertexIndex - 1); // OBJ indices are 1-based, convert to 0-based
-				vertexCount++;
 			}
+		}
+		if (!chunk.faceUv.empty()) chunk.faceUv.resize(chunk.faceVert.size(), Model::noAttribute); // Trailing corners without one
+		if (!chunk.faceNormal.empty()) chunk.faceNormal.resize(chunk.faceVert.size(), Model::noAttribute);
+	}
 
-			if (vertexCount != 3)
+	// Concatenates one attribute's per-chunk indices in file order, resolving relative ones. Indices that point past the
+	// attribute's records become noAttribute and are counted in `invalid`. Leaves `out` empty when no chunk has any.
+	void mergeIndices(std::vector<ObjChunk>& chunks, const size_t used, std::vector<std::uint32_t> ObjChunk::* indices, std::vector<size_t> ObjChunk::* relative,
+		const std::vector<size_t>& recordOffset, const std::vector<size_t>& faceOffset, std::vector<std::uint32_t>& out, size_t& invalid, const unsigned threads)
+	{
+		bool any = false;
+		for (size_t i = 0; i < used; i++) any = any || !(chunks[i].*indices).empty();
+		if (!any) return;
+
+		out.assign(faceOffset[used], Model::noAttribute);
+		std::vector<size_t> bad(used, 0);
+		parallelFor(static_cast<int>(used), threads, [&](const int i)
+		{
+			std::vector<std::uint32_t>& chunkIndices = chunks[i].*indices;
+			for (size_t slot : chunks[i].*relative) chunkIndices[slot] += static_cast<std::uint32_t>(recordOffset[i]);
+			for (std::uint32_t& index : chunkIndices)
 			{
-				std::cerr << "Error: Only triangulated .obj files are supported.\n";
-				return;
+				if (index != Model::noAttribute && index >= recordOffset[used]) // Also catches relative ones from before the first record
+				{
+					index = Model::noAttribute;
+					bad[i]++;
+				}
+			}
+			std::copy(chunkIndices.begin(), chunkIndices.end(), out.begin() + faceOffset[i]);
+		});
+		for (size_t n : bad) invalid += n;
+	}
+}
+
+Model::Model(const std::string filename, const ModelLoadOptions& options)
+{
+	ScopedTimer timer(Stage::Load);
+	auto start = std::chrono::steady_clock::now();
+	MeshCacheArrays arrays;
+	const float weldEpsilon = options.weld ? options.weldEpsilon : -1;
+	if (options.cache && (cacheFile = openMeshCache(filename, arrays, options.verifyCache)) && (arrays.ordering.order != options.order || arrays.weldEpsilon != weldEpsilon))
+	{
+		cacheFile.reset(); // Written with another ordering or welding, parse again and replace it
+	}
+	if (cacheFile)
+	{
+		verts = arrays.positions;
+		face_vert = arrays.indices;
+		faceClusters = arrays.clusters;
+		clusterFaceIds = arrays.clusterFaces;
+		uvs = arrays.uvs;
+		norms = arrays.normals;
+		face_tex = arrays.uvIndices;
+		face_norm = arrays.normalIndices;
+		ordering = arrays.ordering;
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		std::cerr << "# v# " << nverts() << " f# " << nfaces() << " (mapped " << meshCachePath(filename) << " in " << elapsed.count() * 1000 << " ms)\n";
+		if (ordering.order != MeshOrder::File) printOrdering(ordering, -1);
+		printStorage(verts, face_vert);
+		return;
+	}
+
+	if (!loadObj(filename, options.threads))
+	{
+		buildFaceClusters(options.threads); // The faces parsed before an error are still drawn, and the tiled renderer only walks clusters
+		return;
+	}
+	if (options.weld) weld(options.weldEpsilon);
+	optimizeVertexCache(options.order); // Before the clusters, which group faces by id
+	compact(options.weld ? options.weldEpsilon / 2 : 0); // Welding already moves vertices by up to the epsilon, quantizing may move them by half of it
+	printStorage(verts, face_vert);
+	buildFaceClusters(options.threads);
+	if (options.cache) writeMeshCache(filename, { verts, face_vert, faceClusters, clusterFaceIds, uvs, norms, face_tex, face_norm, ordering, weldEpsilon });
+}
+
+Model::Model(std::vector<float> positions, std::vector<std::uint32_t> indices, const bool sequentialClusters, const unsigned threads) : vertStorage(std::move(positions)), indexStorage(std::move(indices))
+{
+	assert(vertStorage.size() % 3 == 0 && indexStorage.size() % 3 == 0);
+	verts = { vertStorage };
+	face_vert = { indexStorage };
+	compact(0);
+	buildFaceClusters(threads, sequentialClusters);
+}
+
+// Welds the parsed vertices (see weldVertices()), and drops the faces that collapse to a line or a point on the way
+// together with their texture coordinate and normal indices
+void Model::weld(const float epsilon)
+{
+	const auto start = std::chrono::steady_clock::now();
+	const int before = nverts(), faces = nfaces();
+	const std::vector<std::uint32_t> remap = weldVertices(vertStorage, epsilon);
+	size_t kept = 0;
+	for (size_t f = 0; f < static_cast<size_t>(faces); f++)
+	{
+		assert(indexStorage[f * 3] < remap.size() && indexStorage[f * 3 + 1] < remap.size() && indexStorage[f * 3 + 2] < remap.size()); // Checked by loadObj()
+		const std::uint32_t a = remap[indexStorage[f * 3]], b = remap[indexStorage[f * 3 + 1]], c = remap[indexStorage[f * 3 + 2]];
+		if (a == b || b == c || c == a) continue;
+		indexStorage[kept * 3] = a;
+		indexStorage[kept * 3 + 1] = b;
+		indexStorage[kept * 3 + 2] = c;
+		if (!uvIndexStorage.empty()) std::copy_n(uvIndexStorage.begin() + f * 3, 3, uvIndexStorage.begin() + kept * 3);
+		if (!normalIndexStorage.empty()) std::copy_n(normalIndexStorage.begin() + f * 3, 3, normalIndexStorage.begin() + kept * 3);
+		kept++;
+	}
+	indexStorage.resize(kept * 3);
+	if (!uvIndexStorage.empty()) uvIndexStorage.resize(kept * 3);
+	if (!normalIndexStorage.empty()) normalIndexStorage.resize(kept * 3);
+	verts = { vertStorage };
+	face_vert = { indexStorage };
+	face_tex = uvIndexStorage;
+	face_norm = normalIndexStorage;
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	std::cerr << "# welded v# " << before << " -> " << nverts() << ", " << faces - nfaces() << " collapsed faces dropped (epsilon " << epsilon
+		<< ", " << elapsed.count() * 1000 << " ms)\n";
+}
+
+// Moves the parsed positions and indices into the smallest formats that hold them: 16 bit indices when every vertex
+// id fits, and positions on a 16 bit grid over the bounding box when each component lands within `tolerance` of
+// where it was, so only exactly with the default 0. Quantized positions are never written back as floats.
+void Model::compact(const float tolerance)
+{
+	const size_t count = vertStorage.size() / 3;
+	if (count > 0 && count <= 0x10000)
+	{
+		narrowIndexStorage.resize(indexStorage.size());
+		std::transform(indexStorage.begin(), indexStorage.end(), narrowIndexStorage.begin(), [count](const std::uint32_t i)
+		{
+			assert(i < count); // Every index names a vertex, so none is cut short
+			return static_cast<std::uint16_t>(i);
+		});
+		indexStorage = {};
+		face_vert = { {}, narrowIndexStorage };
+	}
+
+	if (count == 0) return;
+	QuantizationGrid grid;
+	for (int c = 0; c < 3; c++)
+	{
+		float lo = vertStorage[c], hi = lo;
+		for (size_t i = 1; i < count; i++)
+		{
+			lo = std::min(lo, vertStorage[i * 3 + c]);
+			hi = std::max(hi, vertStorage[i * 3 + c]);
+		}
+		grid.offset[c] = lo;
+		grid.step[c] = (hi - lo) / 65535;
+		if (!std::isfinite(grid.step[c])) return;
+	}
+	std::vector<std::uint16_t> quantized(vertStorage.size());
+	for (size_t i = 0; i < vertStorage.size(); i++)
+	{
+		const int c = static_cast<int>(i % 3);
+		const float step = grid.step[c], p = vertStorage[i];
+		const std::uint16_t q = step > 0 ? static_cast<std::uint16_t>(std::clamp(std::lround((p - grid.offset[c]) / step), 0L, 65535L)) : 0;
+		if (!(std::fabs(grid.decode(c, q) - p) <= tolerance)) return; // Keeps the floats
+		quantized[i] = q;
+	}
+	quantizedStorage = std::move(quantized);
+	vertStorage = {};
+	verts = { {}, quantizedStorage, grid };
+}
+
+// Reorders the parsed faces (and their uv and normal indices) for vertex cache reuse, then optionally renumbers the
+// vertices in order of first use. Every face keeps its corners in the same order, so winding and the image stay the
+// same, up to the order in which faces of equal depth reach the depth test.
+void Model::optimizeVertexCache(const MeshOrder order)
+{
+	const auto start = std::chrono::steady_clock::now();
+	ordering.order = order;
+	ordering.acmrBefore = ordering.acmrAfter = static_cast<float>(acmr(indexStorage, nverts()));
+	if (order == MeshOrder::File) return;
+
+	const std::vector<std::uint32_t> faceOrder = optimizeFaceOrder(indexStorage, nverts());
+	auto permute = [&](std::vector<std::uint32_t>& corners)
+	{
+		if (corners.empty()) return;
+		std::vector<std::uint32_t> reordered(corners.size());
+		for (size_t i = 0; i < faceOrder.size(); i++) std::copy_n(corners.begin() + faceOrder[i] * 3, 3, reordered.begin() + i * 3);
+		corners.swap(reordered);
+	};
+	permute(indexStorage);
+	permute(uvIndexStorage);
+	permute(normalIndexStorage);
+
+	if (order == MeshOrder::FacesAndVertices)
+	{
+		const std::vector<std::uint32_t> remap = vertexFetchOrder(indexStorage, nverts());
+		for (std::uint32_t& v : indexStorage) v = remap[v];
+		std::vector<float> positions(vertStorage.size());
+		for (size_t v = 0; v < remap.size(); v++) std::copy_n(vertStorage.begin() + v * 3, 3, positions.begin() + remap[v] * 3);
+		vertStorage.swap(positions);
+	}
+	verts = { vertStorage };
+	face_vert = { indexStorage };
+	face_tex = uvIndexStorage;
+	face_norm = normalIndexStorage;
+	ordering.acmrAfter = static_cast<float>(acmr(indexStorage, nverts()));
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	printOrdering(ordering, elapsed.count() * 1000);
+}
+
+void Model::buildFaceClusters(const unsigned threads, const bool sequential)
+{
+	clusterStorage = sequential ? buildSequentialClusters(verts, face_vert, threads) : buildClusters(verts, face_vert, threads);
+	faceClusters = clusterStorage.clusters;
+	clusterFaceIds = clusterStorage.faces;
+}
+
+// Parses the OBJ into vertStorage/indexStorage, false if the file could not be opened or was malformed
+bool Model::loadObj(const std::string& filename, const unsigned threads)
+{
+	auto start = std::chrono::steady_clock::now();
+	MappedFile file(filename);
+
+	if (!file.is_open())
+	{
+		std::cerr << "Error opening .obj file: " << filename << std::endl;
+		return false;
+	}
+
+	// Cut the file into newline-aligned chunks, a few per thread so a chunk full of comments or normals does not stall a worker
+	constexpr size_t minChunkBytes = 1 << 20;
+	const char* begin = file.data();
+	const char* end = begin + file.size();
+	const size_t chunkBytes = std::max(minChunkBytes, file.size() / (threads * 4 + 1));
+	std::vector<const char*> cuts = { begin };
+	while (cuts.back() < end)
+	{
+		const char* cut = cuts.back() + std::min(chunkBytes, static_cast<size_t>(end - cuts.back()));
+		cuts.push_back(cut < end ? nextLine(cut - 1, end) : end); // Move forward to the start of the next line
+	}
+
+	std::vector<ObjChunk> chunks(cuts.size() - 1);
+	parallelFor(static_cast<int>(chunks.size()), threads, [&](const int i)
+	{
+		parseChunk(cuts[i], cuts[i + 1], chunks[i]);
+	});
+
+	// A sequential parse stops at the first error, so only keep chunks up to (and including) the first failing one
+	size_t used = 0;
+	while (used < chunks.size() && !chunks[used++].error);
+
+	std::vector<size_t> vertOffset(used + 1, 0), uvOffset(used + 1, 0), normalOffset(used + 1, 0), faceOffset(used + 1, 0);
+	for (size_t i = 0; i < used; i++)
+	{
+		vertOffset[i + 1] = vertOffset[i] + chunks[i].verts.size() / 3;
+		uvOffset[i + 1] = uvOffset[i] + chunks[i].uvs.size() / 2;
+		normalOffset[i + 1] = normalOffset[i] + chunks[i].normals.size() / 3;
+		faceOffset[i + 1] = faceOffset[i] + chunks[i].faceVert.size();
+	}
+
+	// Merge in file order, resolving relative indices now that each chunk knows how many vertices came before it
+	vertStorage.resize(vertOffset[used] * 3);
+	indexStorage.resize(faceOffset[used]);
+	parallelFor(static_cast<int>(used), threads, [&](const int i)
+	{
+		ObjChunk& chunk = chunks[i];
+		for (size_t slot : chunk.relative) chunk.faceVert[slot] += static_cast<std::uint32_t>(vertOffset[i]);
+		std::copy(chunk.verts.begin(), chunk.verts.end(), vertStorage.begin() + vertOffset[i] * 3);
+		std::copy(chunk.faceVert.begin(), chunk.faceVert.end(), indexStorage.begin() + faceOffset[i]);
+	});
+
+	// Texture coordinates and normals only matter when some face refers to them
+	size_t invalid = 0;
+	mergeIndices(chunks, used, &ObjChunk::faceUv, &ObjChunk::relativeUv, uvOffset, faceOffset, uvIndexStorage, invalid, threads);
+	mergeIndices(chunks, used, &ObjChunk::faceNormal, &ObjChunk::relativeNormal, normalOffset, faceOffset, normalIndexStorage, invalid, threads);
+	for (std::vector<std::uint32_t>* indices : { &uvIndexStorage, &normalIndexStorage })
+	{
+		// Not one valid index (f v/vt/vn without vt or vn records, say) is the same as no face referring to the attribute
+		if (std::all_of(indices->begin(), indices->end(), [](const std::uint32_t i) { return i == noAttribute; })) indices->clear();
+	}
+	if (!uvIndexStorage.empty())
+	{
+		uvStorage.resize(uvOffset[used] * 2);
+		for (size_t i = 0; i < used; i++) std::copy(chunks[i].uvs.begin(), chunks[i].uvs.end(), uvStorage.begin() + uvOffset[i] * 2);
+	}
+	if (!normalIndexStorage.empty())
+	{
+		normalStorage.resize(normalOffset[used] * 3);
+		for (size_t i = 0; i < used; i++) std::copy(chunks[i].normals.begin(), chunks[i].normals.end(), normalStorage.begin() + normalOffset[i] * 3);
+	}
+	if (invalid) std::cerr << "Warning: " << invalid << " face corners refer to missing texture coordinates or normals, they get none.\n";
+
+	// Relative indices of every kept chunk first, the faces a failing chunk parsed before its error are kept too
+	const char* error = nullptr;
+	for (size_t i = 0; i < used && !error; i++)
+	{
+		for (size_t slot : chunks[i].relative)
+		{
+			if (static_cast<std::int32_t>(chunks[i].faceVert[slot]) < 0) // Pointed before the first vertex of the file, drop from that face on
+			{
+				indexStorage.resize(faceOffset[i] + slot / 3 * 3);
+				error = "Error: Invalid vertex index in face.\n";
+				break;
 			}
 		}
 	}
+	if (!error && used) error = chunks[used - 1].error;
 
-	std::cerr << "# v# " << nverts() << " f# " << nfaces() << '\n';
+	// Then every position index, like mergeIndices() checks the others. A face cannot do without a vertex, so one past
+	// the end rejects the whole model.
+	std::vector<char> outOfRange(used, 0);
+	parallelFor(static_cast<int>(used), threads, [&](const int i)
+	{
+		const auto first = indexStorage.begin() + std::min(faceOffset[i], indexStorage.size()), last = indexStorage.begin() + std::min(faceOffset[i + 1], indexStorage.size());
+		outOfRange[i] = std::any_of(first, last, [&](const std::uint32_t v) { return v >= vertOffset[used]; });
+	});
+	if (std::find(outOfRange.begin(), outOfRange.end(), 1) != outOfRange.end())
+	{
+		indexStorage.clear();
+		error = "Error: Vertex index out of range in face.\n";
+	}
+	if (!uvIndexStorage.empty()) uvIndexStorage.resize(indexStorage.size());
+	if (!normalIndexStorage.empty()) normalIndexStorage.resize(indexStorage.size());
+	verts = { vertStorage };
+	face_vert = { indexStorage };
+	uvs = uvStorage;
+	norms = normalStorage;
+	face_tex = uvIndexStorage;
+	face_norm = normalIndexStorage;
+	if (error)
+	{
+		std::cerr << error;
+		return false;
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	double megabytes = file.size() / (1024.0 * 1024.0);
+	std::cerr << "# v# " << nverts() << " f# " << nfaces() << " (" << megabytes << " MB in " << elapsed.count() * 1000 << " ms, "
+		<< (elapsed.count() > 0 ? megabytes / elapsed.count() : 0) << " MB/s, " << chunks.size() << " chunks)\n";
+	return true;
 }
 
 // Accessor methods
@@ -68,10 +521,39 @@ int Model::nfaces() const
 
 vec3 Model::vert(const int i) const
 {
-	return verts.at(i);
+	assert(i >= 0 && i < nverts());
+	const vec3f p = verts[i];
+	return { p.x, p.y, p.z };
 }
 
 vec3 Model::vert(const int iface, const int nthvert) const
 {
-	return verts.at(face_vert.at(iface * 3 + nthvert));
-}
\ No newline at end of file
+	return vert(vertIndex(iface, nthvert));
+}
+
+vec3f Model::vertf(const int iface, const int nthvert) const
+{
+	return verts[vertIndex(iface, nthvert)];
+}
+
+int Model::vertIndex(const int iface, const int nthvert) const
+{
+	assert(iface >= 0 && iface < nfaces() && nthvert >= 0 && nthvert < 3);
+	return static_cast<int>(face_vert[iface * 3 + nthvert]);
+}
+
+vec2 Model::uv(const int iface, const int nthvert) const
+{
+	assert(iface >= 0 && iface < nfaces() && nthvert >= 0 && nthvert < 3);
+	if (face_tex.empty() || face_tex[iface * 3 + nthvert] == noAttribute) return { 0, 0 };
+	const std::uint32_t i = face_tex[iface * 3 + nthvert];
+	return { uvs[i * 2], uvs[i * 2 + 1] };
+}
+
+vec3 Model::normal(const int iface, const int nthvert) const
+{
+	assert(iface >= 0 && iface < nfaces() && nthvert >= 0 && nthvert < 3);
+	if (face_norm.empty() || face_norm[iface * 3 + nthvert] == noAttribute) return { 0, 0, 0 };
+	const std::uint32_t i = face_norm[iface * 3 + nthvert];
+	return { norms[i * 3], norms[i * 3 + 1], norms[i * 3 + 2] };
+}
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <profiler.h>
+
+namespace
+{
+	constexpr int nstages = static_cast<int>(Stage::Count);
+	constexpr int ncounters = static_cast<int>(Counter::Count);
+
+	struct TraceEvent
+	{
+		Stage stage;
+		std::int64_t start, duration; // Nanoseconds since enableProfiling()
+	};
+
+	// Events of one thread. Owned by the registry so they outlive the worker that recorded them.
+	struct TraceBuffer
+	{
+		int thread = 0;
+		bool main = false;
+		std::vector<TraceEvent> events = {};
+	};
+
+	std::atomic<bool> enabled = false;
+	bool tracing = false;
+	std::chrono::steady_clock::time_point origin = {};
+	std::thread::id mainThread = {};
+
+	std::atomic<std::uint64_t> stageCalls[nstages] = {};
+	std::atomic<std::int64_t> stageNanoseconds[nstages] = {};
+	std::atomic<std::uint64_t> counters[ncounters] = {};
+
+	std::mutex registryMutex;
+	std::vector<std::unique_ptr<TraceBuffer>> registry;
+	thread_local TraceBuffer* threadBuffer = nullptr;
+
+	// Registered on the first event, after that a thread appends without any locking
+	TraceBuffer& traceBuffer()
+	{
+		if (!threadBuffer)
+		{
+			std::lock_guard<std::mutex> lock(registryMutex);
+			registry.push_back(std::make_unique<TraceBuffer>());
+			registry.back()->thread = static_cast<int>(registry.size());
+			registry.back()->main = std::this_thread::get_id() == mainThread;
+			threadBuffer = registry.back().get();
+		}
+		return *threadBuffer;
+	}
+
+	std::int64_t nanoseconds(const std::chrono::steady_clock::duration d)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+	}
+}
+
+const char* stageName(const Stage stage)
+{
+	static constexpr const char* names[nstages] = { "load", "transform", "transform chunk", "cull", "bin", "raster", "raster tile", "edges", "lines", "encode", "output wait", "stream read", "stream wait" };
+	return names[static_cast<int>(stage)];
+}
+
+const char* counterName(const Counter counter)
+{
+	static constexpr const char* names[ncounters] = {
+		"triangles submitted", "clusters culled", "triangles in culled clusters", "triangles outside", "triangles backfacing", "triangles near clipped", "triangles degenerate", "triangles hi-z culled",
+		"pixels tested", "pixels written", "lines", "line pixels" };
+	return names[static_cast<int>(counter)];
+}
+
+void enableProfiling(const bool trace)
+{
+	tracing = trace;
+	origin = std::chrono::steady_clock::now();
+	mainThread = std::this_thread::get_id();
+	enabled = true;
+}
+
+bool profilingEnabled()
+{
+	return enabled.load(std::memory_order_relaxed);
+}
+
+void addCount(const Counter counter, const std::uint64_t n)
+{
+	if (profilingEnabled()) counters[static_cast<int>(counter)].fetch_add(n, std::memory_order_relaxed);
+}
+
+std::uint64_t count(const Counter counter)
+{
+	return counters[static_cast<int>(counter)].load(std::memory_order_relaxed);
+}
+
+ScopedTimer::~ScopedTimer()
+{
+	if (!active) return;
+	const auto end = std::chrono::steady_clock::now();
+	const int i = static_cast<int>(stage);
+	stageCalls[i].fetch_add(1, std::memory_order_relaxed);
+	stageNanoseconds[i].fetch_add(nanoseconds(end - start), std::memory_order_relaxed);
+	if (tracing) traceBuffer().events.push_back({ stage, nanoseconds(start - origin), nanoseconds(end - start) });
+}
+
+void printProfile(std::ostream& out, const double wallMs)
+{
+	const std::ios::fmtflags flags = out.flags();
+	out << std::fixed << std::setprecision(3);
+	out << std::left << std::setw(18) << "stage" << std::right << std::setw(10) << "calls" << std::setw(14) << "total ms" << std::setw(14) << "avg ms" << std::setw(10) << "% run" << "\n";
+	for (int i = 0; i < nstages; i++)
+	{
+		const std::uint64_t calls = stageCalls[i].load();
+		if (!calls) continue;
+		const double ms = stageNanoseconds[i].load() * 1e-6;
+		out << std::left << std::setw(18) << stageName(static_cast<Stage>(i)) << std::right << std::setw(10) << calls << std::setw(14) << ms
+			<< std::setw(14) << ms / calls << std::setw(10) << std::setprecision(1) << (wallMs > 0 ? ms * 100 / wallMs : 0) << std::setprecision(3) << "\n";
+	}
+	out << std::left << std::setw(18) << "run" << std::right << std::setw(10) << "" << std::setw(14) << wallMs << "\n";
+
+	out << "\n";
+	for (int i = 0; i < ncounters; i++)
+	{
+		const std::uint64_t n = counters[i].load();
+		if (n) out << std::left << std::setw(30) << counterName(static_cast<Counter>(i)) << std::right << std::setw(14) << n << "\n";
+	}
+	out.flags(flags);
+}
+
+bool writeChromeTrace(const std::string& filename)
+{
+	std::ofstream out(filename);
+	if (!out.is_open())
+	{
+		std::cerr << "can't open file " << filename << "\n";
+		return false;
+	}
+
+	// Timestamps are in microseconds, complete ("X") events so nesting comes from the times alone
+	out << std::fixed << std::setprecision(3);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"OpenGLDemo\"}}";
+	std::int64_t last = 0;
+	std::lock_guard<std::mutex> lock(registryMutex);
+	for (const std::unique_ptr<TraceBuffer>& buffer : registry)
+	{
+		out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread << ",\"args\":{\"name\":\""
+			<< (buffer->main ? "main" : "worker") << "\"}}";
+		for (const TraceEvent& e : buffer->events)
+		{
+			out << ",\n{\"name\":\"" << stageName(e.stage) << "\",\"cat\":\"render\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread
+				<< ",\"ts\":" << e.start * 1e-3 << ",\"dur\":" << e.duration * 1e-3 << "}";
+			last = std::max(last, e.start + e.duration);
+		}
+	}
+
+	// Counters as one sample at the end of the run
+	for (int i = 0; i < ncounters; i++)
+	{
+		out << ",\n{\"name\":\"" << counterName(static_cast<Counter>(i)) << "\",\"ph\":\"C\",\"pid\":1,\"ts\":" << last * 1e-3
+			<< ",\"args\":{\"value\":" << counters[i].load() << "}}";
+	}
+	out << "\n]}\n";
+	return out.good();
+}
@@ -0,0 +1,476 @@
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <rasterizer.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RASTER_SSE2
+#endif
+
+namespace
+{
+	// Vertices further than this from the origin could overflow the 32-bit SIMD lanes, those triangles use the 64-bit scalar loop
+	constexpr int guardBand = 1 << 13;
+
+	constexpr int blockSize = DepthBuffer::blockSize;
+
+	// Edge function setup for one triangle, evaluated at the top-left corner of its clipped bounding box.
+	// w0/w1/w2 are twice the signed areas of the sub-triangles opposite to a/b/c, positive inside the triangle.
+	struct EdgeSetup
+	{
+		int minx = 0, miny = 0, maxx = 0, maxy = 0;
+		int startx = 0; // minx rounded down to the Hi-Z block grid, rows are walked one block at a time from there
+		int clipmaxx = 0; // Pixels up to here belong to the current worker
+		std::int64_t w0 = 0, w1 = 0, w2 = 0; // Edge values at (startx, miny)
+		int a0 = 0, a1 = 0, a2 = 0; // Step when moving one pixel right
+		int b0 = 0, b1 = 0, b2 = 0; // Step when moving one row down
+		float az = 0, bz = 0, cz = 0, invArea = 0;
+		float zmax = 0; // Closest depth any pixel of the triangle can get
+		bool fitsInt32 = false;
+	};
+
+	// Rows/columns that received a pixel, so only those Hi-Z blocks get refreshed
+	struct WrittenArea
+	{
+		int minx = INT_MAX, miny = INT_MAX, maxx = -1, maxy = -1;
+		void add(const int x0, const int x1, const int y)
+		{
+			minx = std::min(minx, x0); maxx = std::max(maxx, x1);
+			miny = std::min(miny, y); maxy = std::max(maxy, y);
+		}
+	};
+
+	std::int64_t edge(const RasterVertex& u, const RasterVertex& v, const int px, const int py)
+	{
+		return (std::int64_t(v.x) - u.x) * (std::int64_t(py) - u.y) - (std::int64_t(v.y) - u.y) * (std::int64_t(px) - u.x);
+	}
+
+	// Fixed point triangles whose extent stays below this (1024 pixels) keep every edge value of their bounding box,
+	// plus the block padding, inside the 32-bit SIMD lanes
+	constexpr int subpixelExtent = 1 << 14;
+
+	// A pixel center exactly on the edge u -> v (already turned so the inside is positive) is covered only when this
+	// is a top edge (horizontal, inside below) or a left edge. Of two triangles sharing an edge exactly one owns it.
+	bool topLeft(const int dx, const int dy)
+	{
+		return dy < 0 || (dy == 0 && dx > 0);
+	}
+
+	bool setup(const RasterVertex& a, const RasterVertex& b, const RasterVertex& c, const Tile& clip, const bool subpixel, EdgeSetup& s)
+	{
+		// Use bounding box approach to limit the area we need to scan
+		int minx, miny, maxx, maxy;
+		pixelBounds(a, b, c, subpixel, minx, miny, maxx, maxy);
+		s.minx = std::max(clip.minx, minx);
+		s.miny = std::max(clip.miny, miny);
+		s.maxx = std::min(clip.maxx, maxx);
+		s.maxy = std::min(clip.maxy, maxy);
+		if (s.minx > s.maxx || s.miny > s.maxy) return false;
+		assert(clip.minx % blockSize == 0); // Blocks must not straddle two workers' tiles
+		s.startx = s.minx - s.minx % blockSize;
+		s.clipmaxx = clip.maxx;
+
+		std::int64_t area = edge(a, b, c.x, c.y);
+		if (area == 0) return false; // Degenerate triangle, skip rendering
+
+		// Both windings are drawn, so flip the edges of clockwise triangles to keep "inside" positive.
+		// In subpixel mode the edges are sampled at pixel centers and one pixel is `one` units wide.
+		const int sign = area > 0 ? 1 : -1;
+		const int bits = subpixel ? subpixelBits : 0, one = 1 << bits, half = one >> 1;
+		const int sx = (s.startx << bits) + half, sy = (s.miny << bits) + half;
+		s.w0 = sign * edge(b, c, sx, sy);
+		s.w1 = sign * edge(c, a, sx, sy);
+		s.w2 = sign * edge(a, b, sx, sy);
+		s.a0 = sign * (b.y - c.y) * one; s.b0 = sign * (c.x - b.x) * one;
+		s.a1 = sign * (c.y - a.y) * one; s.b1 = sign * (a.x - c.x) * one;
+		s.a2 = sign * (a.y - b.y) * one; s.b2 = sign * (b.x - a.x) * one;
+		if (subpixel)
+		{
+			// Centers on an edge the triangle does not own get a value of -1, so the same ">= 0" test applies
+			s.w0 -= !topLeft(sign * (c.x - b.x), sign * (c.y - b.y));
+			s.w1 -= !topLeft(sign * (a.x - c.x), sign * (a.y - c.y));
+			s.w2 -= !topLeft(sign * (b.x - a.x), sign * (b.y - a.y));
+		}
+		s.az = static_cast<float>(a.z);
+		s.bz = static_cast<float>(b.z);
+		s.cz = static_cast<float>(c.z);
+		s.invArea = 1.0f / static_cast<float>(area * sign);
+
+		// Interpolated depths are rounded, so pad the vertex maximum by a few ulps to keep Hi-Z rejection conservative
+		const float zbound = std::max({ std::abs(s.az), std::abs(s.bz), std::abs(s.cz) });
+		s.zmax = std::max({ s.az, s.bz, s.cz }) + zbound * 1e-6f;
+
+		if (subpixel)
+		{
+			// Edge values only depend on distances, so the size of the triangle is what matters, not where it is
+			s.fitsInt32 = std::max({ a.x, b.x, c.x }) - std::min({ a.x, b.x, c.x }) < subpixelExtent
+				&& std::max({ a.y, b.y, c.y }) - std::min({ a.y, b.y, c.y }) < subpixelExtent;
+			return true;
+		}
+		s.fitsInt32 = true;
+		for (const RasterVertex* v : { &a, &b, &c })
+		{
+			s.fitsInt32 = s.fitsInt32 && std::abs(v->x) < guardBand && std::abs(v->y) < guardBand;
+		}
+		return true;
+	}
+
+	// Shader inputs of one triangle. varying/w and 1/w are linear in screen space: weighted by a pixel's edge values they
+	// give the perspective correct varyings after one division. Their constant steps per pixel and per row give the
+	// derivatives through the quotient rule, for shaders that ask for them.
+	template<Shader S>
+	class ShaderFill
+	{
+		static constexpr int n = S::varyings;
+		const S& shader;
+		const typename S::Face constants;
+		Varyings<n> c0 = {}, c1 = {}, c2 = {}; // Corner varyings times 1/w, divided by the area so edge values weight them directly
+		float q0 = 0, q1 = 0, q2 = 0; // 1/w of the corners, likewise
+		Varyings<n> dx = {}, dy = {}; // Steps of the weighted sums one pixel right and one row down
+		float dqx = 0, dqy = 0;
+
+	public:
+		static constexpr bool writesColor = S::writesColor;
+		static constexpr bool constant = n == 0; // Nothing varies across the triangle, every pixel gets `color`
+		std::uint32_t color = 0;
+
+		ShaderFill(const EdgeSetup& s, const RasterVertex& a, const RasterVertex& b, const RasterVertex& c, const S& shader, const typename S::Face& constants, const Varyings<n> (&corners)[3])
+			: shader(shader), constants(constants)
+		{
+			if constexpr (constant) color = FrameBuffer::pack(shader.fragment(constants, {}));
+			if constexpr (n > 0)
+			{
+				q0 = a.rhw * s.invArea; q1 = b.rhw * s.invArea; q2 = c.rhw * s.invArea;
+				for (int k = 0; k < n; k++)
+				{
+					c0[k] = corners[0][k] * a.rhw * s.invArea; c1[k] = corners[1][k] * b.rhw * s.invArea; c2[k] = corners[2][k] * c.rhw * s.invArea;
+				}
+				if constexpr (S::derivatives)
+				{
+					dqx = s.a0 * q0 + s.a1 * q1 + s.a2 * q2; dqy = s.b0 * q0 + s.b1 * q1 + s.b2 * q2;
+					for (int k = 0; k < n; k++)
+					{
+						dx[k] = s.a0 * c0[k] + s.a1 * c1[k] + s.a2 * c2[k];
+						dy[k] = s.b0 * c0[k] + s.b1 * c1[k] + s.b2 * c2[k];
+					}
+				}
+			}
+		}
+
+		std::uint32_t operator()(const float e0, const float e1, const float e2) const
+		{
+			if constexpr (constant) return color;
+			Fragment<n> f;
+			if constexpr (n > 0)
+			{
+				const float w = 1.0f / (e0 * q0 + e1 * q1 + e2 * q2);
+				for (int k = 0; k < n; k++) f.value[k] = (e0 * c0[k] + e1 * c1[k] + e2 * c2[k]) * w;
+				if constexpr (S::derivatives)
+				{
+					for (int k = 0; k < n; k++) // d(C/Q) = (dC - value dQ) / Q
+					{
+						f.ddx[k] = (dx[k] - f.value[k] * dqx) * w;
+						f.ddy[k] = (dy[k] - f.value[k] * dqy) * w;
+					}
+				}
+			}
+			return FrameBuffer::pack(shader.fragment(constants, f));
+		}
+	};
+
+	template<typename Fill>
+	void rasterizeScalar(const EdgeSetup& s, const RasterOptions& options, const Fill& fill, DepthBuffer& depth, FrameBuffer& frameBuffer, RasterStats& stats, WrittenArea& written)
+	{
+		std::int64_t w0row = s.w0, w1row = s.w1, w2row = s.w2;
+		for (int y = s.miny; y <= s.maxy; y++) // Row-major, same order as the image memory
+		{
+			const float* blockFar = depth.blockRow(y);
+			std::uint32_t* colors = frameBuffer.row(y);
+			std::int64_t w0 = w0row, w1 = w1row, w2 = w2row;
+			for (int bx = s.startx; bx <= s.maxx; bx += blockSize)
+			{
+				const int x0 = std::max(bx, s.minx), x1 = std::min(bx + blockSize - 1, s.maxx);
+				std::int64_t e0 = w0 + std::int64_t(x0 - bx) * s.a0, e1 = w1 + std::int64_t(x0 - bx) * s.a1, e2 = w2 + std::int64_t(x0 - bx) * s.a2;
+				w0 += blockSize * s.a0; w1 += blockSize * s.a1; w2 += blockSize * s.a2;
+				if (options.hiZ && s.zmax <= blockFar[bx / blockSize])
+				{
+					stats.hiZPixels += x1 - x0 + 1; // Everything already drawn in this block is closer
+					continue;
+				}
+
+				bool any = false;
+				for (int x = x0; x <= x1; x++)
+				{
+					if ((e0 | e1 | e2) >= 0) // All three edge values non-negative: pixel is inside
+					{
+						const float f0 = static_cast<float>(e0), f1 = static_cast<float>(e1), f2 = static_cast<float>(e2);
+						float z = (f0 * s.az + f1 * s.bz + f2 * s.cz) * s.invArea;
+						stats.pixelsTested++;
+						if (depth.testAndSet(x, y, z)) // Closer to camera
+						{
+							if constexpr (Fill::writesColor) colors[x] = fill(f0, f1, f2);
+							stats.pixelsWritten++;
+							any = true;
+						}
+					}
+					e0 += s.a0; e1 += s.a1; e2 += s.a2;
+				}
+				if (any) written.add(x0, x1, y);
+			}
+			w0row += s.b0; w1row += s.b1; w2row += s.b2;
+		}
+	}
+
+#if defined(__AVX2__) || defined(RASTER_SSE2)
+	// Thin wrappers so the block loop below is written once for both vector widths
+#if defined(__AVX2__)
+	constexpr int lanes = 8; // 8x1 pixel blocks
+	using ivec = __m256i;
+	using fvec = __m256;
+	ivec iset(const int v) { return _mm256_set1_epi32(v); }
+	ivec iramp(const int step) { return _mm256_setr_epi32(0, step, 2 * step, 3 * step, 4 * step, 5 * step, 6 * step, 7 * step); }
+	ivec iadd(const ivec a, const ivec b) { return _mm256_add_epi32(a, b); }
+	ivec ior(const ivec a, const ivec b) { return _mm256_or_si256(a, b); }
+	int signbits(const ivec a) { return _mm256_movemask_ps(_mm256_castsi256_ps(a)); }
+	fvec fset(const float v) { return _mm256_set1_ps(v); }
+	fvec tofloat(const ivec a) { return _mm256_cvtepi32_ps(a); }
+	fvec fadd(const fvec a, const fvec b) { return _mm256_add_ps(a, b); }
+	fvec fmul(const fvec a, const fvec b) { return _mm256_mul_ps(a, b); }
+	fvec fload(const float* p) { return _mm256_loadu_ps(p); }
+	void fstore(float* p, const fvec a) { _mm256_storeu_ps(p, a); }
+	fvec fgreater(const fvec a, const fvec b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	fvec fselect(const fvec mask, const fvec a, const fvec b) { return _mm256_blendv_ps(b, a, mask); }
+	int fmask(const fvec a) { return _mm256_movemask_ps(a); }
+	fvec fand(const fvec a, const fvec b) { return _mm256_and_ps(a, b); }
+	fvec nonnegative(const ivec a) { return _mm256_castsi256_ps(_mm256_cmpgt_epi32(a, _mm256_set1_epi32(-1))); }
+#else
+	constexpr int lanes = 4; // 4x1 pixel blocks
+	using ivec = __m128i;
+	using fvec = __m128;
+	ivec iset(const int v) { return _mm_set1_epi32(v); }
+	ivec iramp(const int step) { return _mm_setr_epi32(0, step, 2 * step, 3 * step); }
+	ivec iadd(const ivec a, const ivec b) { return _mm_add_epi32(a, b); }
+	ivec ior(const ivec a, const ivec b) { return _mm_or_si128(a, b); }
+	int signbits(const ivec a) { return _mm_movemask_ps(_mm_castsi128_ps(a)); }
+	fvec fset(const float v) { return _mm_set1_ps(v); }
+	fvec tofloat(const ivec a) { return _mm_cvtepi32_ps(a); }
+	fvec fadd(const fvec a, const fvec b) { return _mm_add_ps(a, b); }
+	fvec fmul(const fvec a, const fvec b) { return _mm_mul_ps(a, b); }
+	fvec fload(const float* p) { return _mm_loadu_ps(p); }
+	void fstore(float* p, const fvec a) { _mm_storeu_ps(p, a); }
+	fvec fgreater(const fvec a, const fvec b) { return _mm_cmpgt_ps(a, b); }
+	fvec fselect(const fvec mask, const fvec a, const fvec b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+	int fmask(const fvec a) { return _mm_movemask_ps(a); }
+	fvec fand(const fvec a, const fvec b) { return _mm_and_ps(a, b); }
+	fvec nonnegative(const ivec a) { return _mm_castsi128_ps(_mm_cmpgt_epi32(a, _mm_set1_epi32(-1))); }
+#endif
+
+	// Same math as rasterizeScalar, evaluated for `lanes` neighbouring pixels of a row at once. The fill runs per written lane, a constant one is blended into the row under the depth mask.
+	template<typename Fill>
+	void rasterizeSimd(const EdgeSetup& s, const RasterOptions& options, const Fill& fill, DepthBuffer& depth, FrameBuffer& frameBuffer, RasterStats& stats, WrittenArea& written)
+	{
+		const ivec ramp0 = iramp(s.a0), ramp1 = iramp(s.a1), ramp2 = iramp(s.a2);
+		const int step0 = s.a0 * lanes, step1 = s.a1 * lanes, step2 = s.a2 * lanes;
+		const fvec az = fset(s.az), bz = fset(s.bz), cz = fset(s.cz), invArea = fset(s.invArea);
+		alignas(32) float zValues[lanes];
+
+		int w0row = static_cast<int>(s.w0), w1row = static_cast<int>(s.w1), w2row = static_cast<int>(s.w2);
+		for (int y = s.miny; y <= s.maxy; y++)
+		{
+			const float* blockFar = depth.blockRow(y);
+			float* zrow = depth.row(y);
+			std::uint32_t* colors = frameBuffer.row(y);
+			int w0 = w0row, w1 = w1row, w2 = w2row;
+			for (int bx = s.startx; bx <= s.maxx; bx += blockSize)
+			{
+				if (options.hiZ && s.zmax <= blockFar[bx / blockSize])
+				{
+					stats.hiZPixels += std::min(bx + blockSize - 1, s.maxx) - std::max(bx, s.minx) + 1;
+					w0 += blockSize * s.a0; w1 += blockSize * s.a1; w2 += blockSize * s.a2;
+					continue;
+				}
+
+				bool any = false;
+				for (int x = bx; x < bx + blockSize && x <= s.maxx; x += lanes)
+				{
+					ivec e0 = iadd(iset(w0), ramp0);
+					ivec e1 = iadd(iset(w1), ramp1);
+					ivec e2 = iadd(iset(w2), ramp2);
+					const int l0 = w0, l1 = w1, l2 = w2; // Edge values of the first lane, lane i adds i steps
+					w0 += step0; w1 += step1; w2 += step2;
+
+					// A lane is inside when none of its edge values has the sign bit set.
+					// Lanes outside the bounding box are never inside, the triangle is convex.
+					const ivec outside = ior(ior(e0, e1), e2);
+					int covered = ~signbits(outside) & ((1 << lanes) - 1);
+					if (!covered) continue;
+
+					fvec z = fmul(fadd(fadd(fmul(tofloat(e0), az), fmul(tofloat(e1), bz)), fmul(tofloat(e2), cz)), invArea);
+					if (x + lanes - 1 <= s.clipmaxx)
+					{
+						// All lanes belong to this worker: depth test and write them at once
+						stats.pixelsTested += std::popcount(static_cast<unsigned>(covered));
+						const fvec current = fload(zrow + x);
+						const fvec pass = fand(nonnegative(outside), fgreater(z, current));
+						const int passed = fmask(pass);
+						if (!passed) continue;
+						stats.pixelsWritten += std::popcount(static_cast<unsigned>(passed));
+						fstore(zrow + x, fselect(pass, z, current));
+						if constexpr (Fill::constant && Fill::writesColor)
+						{
+							// One color for every lane, blended into the row under the depth mask
+							float* target = reinterpret_cast<float*>(colors + x);
+							fstore(target, fselect(pass, fset(std::bit_cast<float>(fill.color)), fload(target)));
+						}
+						else if constexpr (Fill::writesColor)
+						{
+							for (int i = 0; i < lanes; i++)
+							{
+								if (passed & (1 << i)) colors[x + i] = fill(static_cast<float>(l0 + i * s.a0), static_cast<float>(l1 + i * s.a1), static_cast<float>(l2 + i * s.a2));
+							}
+						}
+						any = true;
+					}
+					else
+					{
+						// Block hangs past the edge of the tile (or the screen), go lane by lane
+						fstore(zValues, z);
+						for (int i = 0; i < lanes && x + i <= s.maxx; i++)
+						{
+							if (!(covered & (1 << i))) continue;
+							stats.pixelsTested++;
+							if (depth.testAndSet(x + i, y, zValues[i]))
+							{
+								if constexpr (Fill::writesColor) colors[x + i] = fill(static_cast<float>(l0 + i * s.a0), static_cast<float>(l1 + i * s.a1), static_cast<float>(l2 + i * s.a2));
+								stats.pixelsWritten++;
+								any = true;
+							}
+						}
+					}
+				}
+				w0 = w0row + (bx + blockSize - s.startx) * s.a0; // Resync after a row end that stopped mid-block
+				w1 = w1row + (bx + blockSize - s.startx) * s.a1;
+				w2 = w2row + (bx + blockSize - s.startx) * s.a2;
+				if (any) written.add(std::max(bx, s.minx), std::min(bx + blockSize - 1, s.maxx), y);
+			}
+			w0row += s.b0; w1row += s.b1; w2row += s.b2;
+		}
+	}
+#define RASTER_HAS_SIMD
+#endif
+}
+
+bool simdRasterAvailable()
+{
+#if defined(RASTER_HAS_SIMD)
+	return true;
+#else
+	return false;
+#endif
+}
+
+const char* simdRasterName()
+{
+#if defined(__AVX2__)
+	return "AVX2";
+#elif defined(RASTER_SSE2)
+	return "SSE2";
+#else
+	return "none";
+#endif
+}
+
+RasterStats& RasterStats::operator+=(const RasterStats& other)
+{
+	hiZTriangles += other.hiZTriangles;
+	hiZPixels += other.hiZPixels;
+	pixelsTested += other.pixelsTested;
+	pixelsWritten += other.pixelsWritten;
+	outside += other.outside;
+	backfacing += other.backfacing;
+	clipped += other.clipped;
+	clusters += other.clusters;
+	clusterFaces += other.clusterFaces;
+	degenerate += other.degenerate;
+	return *this;
+}
+
+bool degenerate(const RasterVertex& a, const RasterVertex& b, const RasterVertex& c)
+{
+	return edge(a, b, c.x, c.y) == 0;
+}
+
+void pixelBounds(const RasterVertex& a, const RasterVertex& b, const RasterVertex& c, const bool subpixel, int& minx, int& miny, int& maxx, int& maxy)
+{
+	minx = std::min({ a.x, b.x, c.x });
+	miny = std::min({ a.y, b.y, c.y });
+	maxx = std::max({ a.x, b.x, c.x });
+	maxy = std::max({ a.y, b.y, c.y });
+	if (!subpixel) return;
+
+	// Pixel p has its center at p * 16 + 8, keep the pixels with a center in [min, max]. Shifts round down for negatives too.
+	constexpr int half = 1 << (subpixelBits - 1);
+	minx = (minx + half - 1) >> subpixelBits;
+	miny = (miny + half - 1) >> subpixelBits;
+	maxx = (maxx - half) >> subpixelBits;
+	maxy = (maxy - half) >> subpixelBits;
+}
+
+namespace
+{
+	// Hi-Z test of the whole triangle, then the inner loop matching the options, then the Hi-Z refresh
+	template<typename Fill>
+	bool fillTriangle(const EdgeSetup& s, const Fill& fill, DepthBuffer& depth, FrameBuffer& frameBuffer, const RasterOptions& options, RasterStats& stats)
+	{
+		if (options.hiZ && depth.occluded(s.minx, s.miny, s.maxx, s.maxy, s.zmax))
+		{
+			stats.hiZTriangles++; // Hidden behind what is already drawn, no pixel work at all
+			stats.hiZPixels += std::uint64_t(s.maxx - s.minx + 1) * (s.maxy - s.miny + 1);
+			return false;
+		}
+
+		WrittenArea written;
+#if defined(RASTER_HAS_SIMD)
+		if (options.mode == RasterMode::Simd && s.fitsInt32)
+		{
+			rasterizeSimd(s, options, fill, depth, frameBuffer, stats, written);
+		}
+		else
+#endif
+		{
+			rasterizeScalar(s, options, fill, depth, frameBuffer, stats, written);
+		}
+
+		if (written.maxx >= 0) depth.updateBlocks(written.minx, written.miny, written.maxx, written.maxy);
+		return true;
+	}
+}
+
+template<Shader S>
+bool triangle(const RasterVertex& a, const RasterVertex& b, const RasterVertex& c, const S& shader, const typename S::Face& constants, const Varyings<S::varyings> (&corners)[3], const Tile& clip, DepthBuffer& depth, FrameBuffer& frameBuffer, const RasterOptions& options, RasterStats& stats)
+{
+	EdgeSetup s;
+	if (!setup(a, b, c, clip, options.subpixel, s)) return true;
+	return fillTriangle(s, ShaderFill<S>(s, a, b, c, shader, constants, corners), depth, frameBuffer, options, stats);
+}
+
+// One inner loop per shader
+template bool triangle(const RasterVertex&, const RasterVertex&, const RasterVertex&, const FlatShader&, const FlatShader::Face&, const Varyings<FlatShader::varyings> (&)[3], const Tile&, DepthBuffer&, FrameBuffer&, const RasterOptions&, RasterStats&);
+template bool triangle(const RasterVertex&, const RasterVertex&, const RasterVertex&, const DepthShader&, const DepthShader::Face&, const Varyings<DepthShader::varyings> (&)[3], const Tile&, DepthBuffer&, FrameBuffer&, const RasterOptions&, RasterStats&);
+template bool triangle(const RasterVertex&, const RasterVertex&, const RasterVertex&, const GouraudShader&, const GouraudShader::Face&, const Varyings<GouraudShader::varyings> (&)[3], const Tile&, DepthBuffer&, FrameBuffer&, const RasterOptions&, RasterStats&);
+template bool triangle(const RasterVertex&, const RasterVertex&, const RasterVertex&, const PhongShader<false>&, const PhongShader<false>::Face&, const Varyings<PhongShader<false>::varyings> (&)[3], const Tile&, DepthBuffer&, FrameBuffer&, const RasterOptions&, RasterStats&);
+template bool triangle(const RasterVertex&, const RasterVertex&, const RasterVertex&, const PhongShader<true>&, const PhongShader<true>::Face&, const Varyings<PhongShader<true>::varyings> (&)[3], const Tile&, DepthBuffer&, FrameBuffer&, const RasterOptions&, RasterStats&);
+template bool triangle(const RasterVertex&, const RasterVertex&, const RasterVertex&, const NormalShader&, const NormalShader::Face&, const Varyings<NormalShader::varyings> (&)[3], const Tile&, DepthBuffer&, FrameBuffer&, const RasterOptions&, RasterStats&);
+template bool triangle(const RasterVertex&, const RasterVertex&, const RasterVertex&, const TextureShader&, const TextureShader::Face&, const Varyings<TextureShader::varyings> (&)[3], const Tile&, DepthBuffer&, FrameBuffer&, const RasterOptions&, RasterStats&);
+
+bool triangle(const RasterVertex& a, const RasterVertex& b, const RasterVertex& c, const TGAColor color, const Tile& clip, DepthBuffer& depth, FrameBuffer& frameBuffer, const RasterOptions& options, RasterStats& stats)
+{
+	const Varyings<0> none[3] = {};
+	return triangle(a, b, c, FlatShader({}), color, none, clip, depth, frameBuffer, options, stats);
+}
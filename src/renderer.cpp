@@ -0,0 +1,373 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include <clipper.h>
+#include <clusters.h>
+#include <parallel.h>
+#include <profiler.h>
+#include <renderer.h>
+#include <tiler.h>
+#include <wireframe.h>
+
+int line(int ax, int ay, int bx, int by, FrameBuffer& frameBuffer, TGAColor color)
+{
+	return drawSegment({ ax, ay, bx, by }, 0, 0, frameBuffer.width() - 1, frameBuffer.height() - 1, frameBuffer, FrameBuffer::pack(color));
+}
+
+bool isBackFacing(const vec3f& v0, const vec3f& v1, const vec3f& v2, const vec3f& eye)
+{
+	// Backface culling: Calculating triangle normal
+	vec3f edge1 = v1 - v0;
+	vec3f edge2 = v2 - v0;
+	vec3f normal = cross(edge1, edge2);
+	
+	// Camera direction assuming is at origin looking down the negative Z-axis
+	vec3f triangleCenter = (v0 + v1 + v2) / 3.0f;
+	vec3f cameraDir = normalized(eye - triangleCenter);
+
+	// If dot product is negative, triangle is facing away from camera
+	// Based on the angle between the triangle normal and camera direction we can determine visibility
+	return normal * cameraDir <= 0;
+}
+
+// Rotate vector around Y-axis by 60 degrees. Making the model spin around Y-axis
+//vec3 rot(vec3 vector)
+//{
+//	constexpr double angle = std::numbers::pi / 6; // Rotation angle in radians
+//	double cosAngle = std::cos(angle);
+//	double singAngle = std::sin(angle);
+//
+//	mat<3, 3> Ry;
+//	Ry[0][0] = cosAngle; Ry[0][1] = 0; Ry[0][2] = singAngle;
+//	Ry[1][0] = 0;        Ry[1][1] = 1; Ry[1][2] = 0;
+//	Ry[2][0] = -singAngle; Ry[2][1] = 0; Ry[2][2] = cosAngle;
+//
+//
+//	return Ry * vector; // Rotate around Y-axis
+//}
+
+
+// Project 3D coordinates to 2D screen space orthographic projection
+std::tuple<int, int, double> project(const mat<4, 4>& viewport, const vec4& vector)
+{
+	vec4 ndc = vector / vector.w; // Prespective divide
+	vec4 screen = viewport * ndc; // Screen space coordinates
+	return { static_cast<int>(screen.x), static_cast<int>(screen.y), ndc.z }; // Return NDC z for depth testing
+}
+
+namespace
+{
+	// A face whose corners all lie outside the same clip plane cannot reach the screen
+	bool outsideFrustum(const Model& model, const ScreenVertices& screen, const int face)
+	{
+		return (screen.clip[model.vertIndex(face, 0)] & screen.clip[model.vertIndex(face, 1)] & screen.clip[model.vertIndex(face, 2)]) != 0;
+	}
+
+	bool crossesNear(const Model& model, const ScreenVertices& screen, const int face)
+	{
+		return ((screen.clip[model.vertIndex(face, 0)] | screen.clip[model.vertIndex(face, 1)] | screen.clip[model.vertIndex(face, 2)]) & ClipNear) != 0;
+	}
+
+	// Cuts a face crossing the near plane down to the part in front of it, as a fan of at most two triangles, with the
+	// weights of the face's corners at each of their corners. Returns how many. Corners in front of the plane land on
+	// exactly the pixels transformVertices() gave them.
+	int clipFace(const Model& model, const ScreenVertices& screen, const int face, RasterVertex (&out)[2][3], vec3f (&weightsOut)[2][3])
+	{
+		vec4f corners[3], polygon[4];
+		vec3f weights[4];
+		for (int k = 0; k < 3; k++)
+		{
+			const vec3f v = model.vertf(face, k);
+			corners[k] = toClip(screen.transform, v.x, v.y, v.z);
+		}
+		const int n = clipNear(corners, polygon, weights);
+
+		int count = 0;
+		for (int k = 1; k + 1 < n; k++)
+		{
+			out[count][0] = toRaster(polygon[0], screen.subpixelBits);
+			out[count][1] = toRaster(polygon[k], screen.subpixelBits);
+			out[count][2] = toRaster(polygon[k + 1], screen.subpixelBits);
+			weightsOut[count][0] = weights[0];
+			weightsOut[count][1] = weights[k];
+			weightsOut[count][2] = weights[k + 1];
+			count++;
+		}
+		return count;
+	}
+
+	bool binTriangle(TileBinner& binner, const int id, const RasterVertex& a, const RasterVertex& b, const RasterVertex& c, const bool subpixel)
+	{
+		int minx, miny, maxx, maxy;
+		pixelBounds(a, b, c, subpixel, minx, miny, maxx, maxy);
+		return binner.bin(id, minx, miny, maxx, maxy);
+	}
+
+	// Piece of a near clipped face, binned after the original faces' ids
+	struct ClippedTriangle
+	{
+		RasterVertex a, b, c;
+		vec3f weights[3]; // Of the face's corners, to blend their varyings
+		int face;
+	};
+
+	// A whole face, its corners straight from the vertex stage
+	template<Shader S>
+	bool drawFace(const S& shader, const Model& model, const ScreenVertices& screen, const int face, const Tile& clip, DepthBuffer& zBuffer, FrameBuffer& frameBuffer, const RasterOptions& options, RasterStats& stats)
+	{
+		const Varyings<S::varyings> corners[3] = { shader.vertex(face, 0), shader.vertex(face, 1), shader.vertex(face, 2) };
+		return triangle(screen[model.vertIndex(face, 0)], screen[model.vertIndex(face, 1)], screen[model.vertIndex(face, 2)], shader, shader.face(face), corners, clip, zBuffer, frameBuffer, options, stats);
+	}
+
+	// A piece of a face cut at the near plane, its varyings blended from the face's corners
+	template<Shader S>
+	bool drawPiece(const S& shader, const ClippedTriangle& t, const Tile& clip, DepthBuffer& zBuffer, FrameBuffer& frameBuffer, const RasterOptions& options, RasterStats& stats)
+	{
+		constexpr int n = S::varyings;
+		Varyings<n> corners[3] = {};
+		if constexpr (n > 0)
+		{
+			const Varyings<n> face[3] = { shader.vertex(t.face, 0), shader.vertex(t.face, 1), shader.vertex(t.face, 2) };
+			for (int k = 0; k < 3; k++)
+			{
+				for (int j = 0; j < n; j++) corners[k][j] = t.weights[k].x * face[0][j] + t.weights[k].y * face[1][j] + t.weights[k].z * face[2][j];
+			}
+		}
+		return triangle(t.a, t.b, t.c, shader, shader.face(t.face), corners, clip, zBuffer, frameBuffer, options, stats);
+	}
+
+	// Multithreaded --faces path: cull faces in parallel, bin them into screen tiles,
+	// then let each worker rasterize whole tiles. Produces the same image as the single-threaded loop.
+	template<Shader S>
+	void renderFacesTiled(const Model& model, const vec3f& eye, const ScreenVertices& screen, const S& shader, DepthBuffer& zBuffer, FrameBuffer& frameBuffer, const unsigned threads, const RasterOptions& options, RasterStats& stats)
+	{
+		const int nfaces = model.nfaces();
+		std::vector<char> visible(nfaces, 0);
+
+		// Front end: whole clusters first, then the faces of the clusters that survive
+		const std::span<const Cluster> clusters = model.clusters();
+		const ClusterCuller culler(screen.transform, frameBuffer.width(), frameBuffer.height(), eye);
+		constexpr int clustersPerJob = 64; // Enough faces per job to amortize the scheduling
+		const int jobs = (static_cast<int>(clusters.size()) + clustersPerJob - 1) / clustersPerJob;
+		std::vector<RasterStats> jobStats(jobs);
+		{
+			ScopedTimer timer(Stage::Cull);
+			parallelFor(jobs, threads, [&](const int j)
+			{
+				RasterStats& culled = jobStats[j];
+				for (int c = j * clustersPerJob; c < std::min(static_cast<int>(clusters.size()), (j + 1) * clustersPerJob); c++)
+				{
+					const Cluster& cluster = clusters[c];
+					if (options.clusterCulling && culler.test(cluster) != ClusterVisibility::Visible)
+					{
+						culled.clusters++;
+						culled.clusterFaces += cluster.count;
+						continue;
+					}
+					for (const std::uint32_t i : model.clusterFaces(cluster))
+					{
+						if (outsideFrustum(model, screen, i)) culled.outside++;
+						else if (isBackFacing(model.vertf(i, 0), model.vertf(i, 1), model.vertf(i, 2), eye)) culled.backfacing++;
+						else visible[i] = 1;
+					}
+				}
+			});
+		}
+		for (const RasterStats& s : jobStats) stats += s;
+
+		// Binning is serial so each tile sees its triangles in face order, exactly like the single-threaded loop
+		TileBinner binner(frameBuffer.width(), frameBuffer.height());
+		std::vector<ClippedTriangle> clipped;
+		{
+			ScopedTimer timer(Stage::Bin);
+			for (int i = 0; i < nfaces; i++)
+			{
+				if (!visible[i]) continue;
+				if (crossesNear(model, screen, i))
+				{
+					stats.clipped++;
+					RasterVertex pieces[2][3];
+					vec3f weights[2][3];
+					const int n = clipFace(model, screen, i, pieces, weights);
+					visible[i] = false;
+					for (int k = 0; k < n; k++)
+					{
+						const RasterVertex& a = pieces[k][0], & b = pieces[k][1], & c = pieces[k][2];
+						if (degenerate(a, b, c)) continue;
+						clipped.push_back({ a, b, c, { weights[k][0], weights[k][1], weights[k][2] }, i });
+						if (binTriangle(binner, nfaces + static_cast<int>(clipped.size()) - 1, a, b, c, options.subpixel))
+						{
+							visible[i] = true;
+						}
+					}
+					continue;
+				}
+				const RasterVertex a = screen[model.vertIndex(i, 0)], b = screen[model.vertIndex(i, 1)], c = screen[model.vertIndex(i, 2)];
+				if (degenerate(a, b, c))
+				{
+					stats.degenerate++;
+					visible[i] = false;
+					continue;
+				}
+				visible[i] = binTriangle(binner, i, a, b, c, options.subpixel);
+			}
+		}
+
+		// A triangle spanning several tiles only counts as Hi-Z culled when every one of its tiles rejected it
+		std::unique_ptr<std::atomic<bool>[]> drawn(new std::atomic<bool>[nfaces]());
+		std::vector<RasterStats> tileStats(binner.ntiles()); // One per tile, so workers never share a counter
+		binner.rasterize(threads, [&](const Tile& tile, const int i)
+		{
+			if (i < nfaces)
+			{
+				if (drawFace(shader, model, screen, i, tile, zBuffer, frameBuffer, options, tileStats[tile.index]))
+				{
+					drawn[i].store(true, std::memory_order_relaxed);
+				}
+				return;
+			}
+			const ClippedTriangle& t = clipped[i - nfaces];
+			if (drawPiece(shader, t, tile, zBuffer, frameBuffer, options, tileStats[tile.index]))
+			{
+				drawn[t.face].store(true, std::memory_order_relaxed);
+			}
+		});
+		RasterStats pixels;
+		for (const RasterStats& s : tileStats) pixels += s;
+		stats.hiZPixels += pixels.hiZPixels;
+		stats.pixelsTested += pixels.pixelsTested;
+		stats.pixelsWritten += pixels.pixelsWritten;
+		for (int i = 0; i < nfaces; i++)
+		{
+			if (visible[i] && !drawn[i].load(std::memory_order_relaxed)) stats.hiZTriangles++;
+		}
+	}
+
+	// The single-threaded loop, culling and rasterization interleaved
+	template<Shader S>
+	void renderFacesSerial(const Model& model, const vec3f& eye, const ScreenVertices& screen, const S& shader, DepthBuffer& zBuffer, FrameBuffer& frameBuffer, const RasterOptions& options, RasterStats& stats)
+	{
+		const Tile whole = { 0, 0, frameBuffer.width() - 1, frameBuffer.height() - 1 };
+		// Faces of clusters that are rejected whole, the loop below still visits every face to draw them in order
+		std::vector<char> skip(model.nfaces(), 0);
+		if (options.clusterCulling)
+		{
+			const ClusterCuller culler(screen.transform, frameBuffer.width(), frameBuffer.height(), eye);
+			for (const Cluster& cluster : model.clusters())
+			{
+				if (culler.test(cluster) == ClusterVisibility::Visible) continue;
+				stats.clusters++;
+				stats.clusterFaces += cluster.count;
+				for (const std::uint32_t i : model.clusterFaces(cluster)) skip[i] = 1;
+			}
+		}
+
+		for (int i = 0; i < model.nfaces(); i++) // Iterating through all faces
+		{
+			if (skip[i]) continue;
+			if (outsideFrustum(model, screen, i)) // Skip triangle if it misses the screen or lies behind the camera
+			{
+				stats.outside++;
+				continue;
+			}
+			if (isBackFacing(model.vertf(i, 0), model.vertf(i, 1), model.vertf(i, 2), eye)) // Skip triangle if facing away from camera
+			{
+				stats.backfacing++;
+				continue;
+			}
+
+			if (crossesNear(model, screen, i))
+			{
+				stats.clipped++;
+				RasterVertex pieces[2][3];
+				vec3f weights[2][3];
+				const int n = clipFace(model, screen, i, pieces, weights);
+				int rasterized = 0, rejected = 0;
+				for (int k = 0; k < n; k++)
+				{
+					if (degenerate(pieces[k][0], pieces[k][1], pieces[k][2])) continue;
+					rasterized++;
+					const ClippedTriangle piece = { pieces[k][0], pieces[k][1], pieces[k][2], { weights[k][0], weights[k][1], weights[k][2] }, i };
+					if (!drawPiece(shader, piece, whole, zBuffer, frameBuffer, options, stats)) rejected++;
+				}
+				stats.hiZTriangles -= rejected - (rejected && rejected == rasterized ? 1 : 0); // Count the face once, like the tiled path
+				continue;
+			}
+
+			const RasterVertex a = screen[model.vertIndex(i, 0)], b = screen[model.vertIndex(i, 1)], c = screen[model.vertIndex(i, 2)];
+			if (degenerate(a, b, c))
+			{
+				stats.degenerate++;
+				continue;
+			}
+
+			// Fill the projected triangle with edge functions
+			drawFace(shader, model, screen, i, whole, zBuffer, frameBuffer, options, stats);
+		}
+	}
+}
+
+std::vector<TGAColor> randomFaceColors(const int nfaces)
+{
+	std::vector<TGAColor> colors(nfaces);
+	for (TGAColor& color : colors)
+	{
+		color = { rand() % 256, rand() % 256, rand() % 256, 255 };
+	}
+	return colors;
+}
+
+void renderFaces(const Model& model, const View& view, const ScreenVertices& screen, const Shading& shading, DepthBuffer& zBuffer, FrameBuffer& frameBuffer, const unsigned threads, const RasterOptions& options, RasterStats& stats)
+{
+	ScopedTimer timer(Stage::Raster);
+	assert((screen.subpixelBits == subpixelBits) == options.subpixel); // transformVertices() has to produce the matching positions
+	RasterStats frame;
+	const vec3f eye = tofloat(view.camera.eye);
+
+	// The shader is picked once per frame, everything below is compiled separately for each one
+	auto render = [&](const auto& shader)
+	{
+		if (threads > 1)
+		{
+			renderFacesTiled(model, eye, screen, shader, zBuffer, frameBuffer, threads, options, frame);
+		}
+		else
+		{
+			renderFacesSerial(model, eye, screen, shader, zBuffer, frameBuffer, options, frame);
+		}
+	};
+	const Texture* texture = shading.texture && !shading.texture->empty() && model.hasUVs() ? shading.texture : nullptr;
+	switch (shading.kind)
+	{
+	case ShaderKind::Depth: render(DepthShader()); break;
+	case ShaderKind::Gouraud: render(GouraudShader(model, shading.light)); break;
+	case ShaderKind::Normals: render(NormalShader(model)); break;
+	case ShaderKind::Phong:
+		if (texture) render(PhongShader<true>(model, shading.light, eye, texture, options.filter, options.mipmaps));
+		else render(PhongShader<false>(model, shading.light, eye));
+		break;
+	case ShaderKind::Texture:
+		if (texture)
+		{
+			render(TextureShader(model, *texture, options.filter, options.mipmaps));
+			break;
+		}
+		[[fallthrough]]; // Nothing to texture with, flat colors like without a texture
+	case ShaderKind::Flat: render(FlatShader(shading.colors)); break;
+	}
+	stats += frame;
+
+	addCount(Counter::TrianglesSubmitted, model.nfaces());
+	addCount(Counter::Clusters, frame.clusters);
+	addCount(Counter::ClusterFaces, frame.clusterFaces);
+	addCount(Counter::TrianglesOutside, frame.outside);
+	addCount(Counter::TrianglesBackfacing, frame.backfacing);
+	addCount(Counter::TrianglesClipped, frame.clipped);
+	addCount(Counter::TrianglesDegenerate, frame.degenerate);
+	addCount(Counter::TrianglesHiZ, frame.hiZTriangles);
+	addCount(Counter::PixelsTested, frame.pixelsTested);
+	addCount(Counter::PixelsWritten, frame.pixelsWritten);
+}
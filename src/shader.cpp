@@ -0,0 +1,11 @@
+#include <shader.h>
+
+vec3f cornerNormal(const Model& model, const int face, const int corner)
+{
+	const vec3 n = model.normal(face, corner);
+	if (n.x != 0 || n.y != 0 || n.z != 0) return normalized(tofloat(n));
+
+	// No normal in the file: the face's own, which flat shades the face
+	const vec3f a = model.vertf(face, 0), b = model.vertf(face, 1), c = model.vertf(face, 2);
+	return normalized(cross(b - a, c - a));
+}
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <meshcache.h>
+#include <profiler.h>
+#include <streaming.h>
+
+namespace
+{
+	// Vertex ids less than this apart are read as one run, the unused ones in between are read and skipped.
+	// A run never spans more than maxRun ids, so the read buffer stays small.
+	constexpr std::uint32_t maxGap = 256;
+	constexpr std::uint32_t maxRun = 1 << 16;
+
+	// Faces of the cache with their vertices renumbered from 0, as a small model of their own
+	struct Chunk
+	{
+		std::unique_ptr<Model> model = {};
+		std::uint64_t bytes = 0;
+	};
+
+	bool readChunk(MeshCacheStream& stream, const std::uint64_t first, const std::uint64_t count, const unsigned threads, Chunk& chunk)
+	{
+		ScopedTimer timer(Stage::StreamRead);
+		std::vector<std::uint32_t> indices;
+		if (!stream.readFaces(first, count, indices)) return false;
+
+		// The chunk's vertex ids in ascending order. In vertex cache order they cover a narrow window of the mesh, which a
+		// table over the window dedupes and later renumbers without a sort; scattered ids go through sort and binary search.
+		const auto [lo, hi] = std::minmax_element(indices.begin(), indices.end());
+		if (*hi >= stream.nverts()) return false; // Corrupt cache, the face names a vertex it does not have
+		const std::uint32_t base = *lo;
+		const std::uint64_t window = std::uint64_t(*hi) - *lo + 1;
+		const bool dense = window <= 4 * indices.size();
+		std::vector<std::uint32_t> ids, local;
+		if (dense)
+		{
+			constexpr std::uint32_t unused = 0xFFFFFFFF;
+			local.assign(window, unused);
+			for (const std::uint32_t v : indices) local[v - base] = 0;
+			for (size_t i = 0; i < window; i++)
+			{
+				if (local[i] == unused) continue;
+				local[i] = static_cast<std::uint32_t>(ids.size());
+				ids.push_back(base + static_cast<std::uint32_t>(i));
+			}
+		}
+		else
+		{
+			ids = indices;
+			std::sort(ids.begin(), ids.end());
+			ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+		}
+
+		std::vector<float> positions, run;
+		positions.reserve(ids.size() * 3);
+		for (size_t i = 0; i < ids.size();)
+		{
+			size_t j = i + 1;
+			while (j < ids.size() && ids[j] - ids[j - 1] <= maxGap && ids[j] - ids[i] < maxRun) j++;
+			run.clear();
+			if (!stream.readPositions(ids[i], ids[j - 1] - ids[i] + 1, run)) return false;
+			for (size_t k = i; k < j; k++) positions.insert(positions.end(), run.begin() + (ids[k] - ids[i]) * 3, run.begin() + (ids[k] - ids[i]) * 3 + 3);
+			i = j;
+		}
+		for (std::uint32_t& v : indices)
+		{
+			v = dense ? local[v - base] : static_cast<std::uint32_t>(std::lower_bound(ids.begin(), ids.end(), v) - ids.begin());
+		}
+
+		chunk.bytes = positions.size() * sizeof(float) + indices.size() * sizeof(std::uint32_t);
+		chunk.model = std::make_unique<Model>(std::move(positions), std::move(indices), true, threads);
+		return true;
+	}
+}
+
+bool renderStreamed(const std::string& objFilename, const View& view, const Shading& shading, DepthBuffer& zBuffer, FrameBuffer& frameBuffer, const unsigned threads, const RasterOptions& options, const StreamOptions& streamOptions, RasterStats& stats, StreamStats& streamStats)
+{
+	assert(shading.kind == ShaderKind::Flat || shading.kind == ShaderKind::Depth); // Chunks have no texture coordinates or normals
+	MeshCacheStream stream;
+	if (!stream.open(objFilename)) return false;
+	const std::uint64_t chunkFaces = std::max<std::uint32_t>(streamOptions.chunkFaces, 1);
+	const std::uint64_t nchunks = (stream.nfaces() + chunkFaces - 1) / chunkFaces;
+
+	// The reader stays at most one finished chunk ahead: one is rendered, one waits and one is being read
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<Chunk> ready;
+	bool failed = false, stopping = false;
+	std::thread reader([&]
+	{
+		for (std::uint64_t c = 0; c < nchunks; c++)
+		{
+			Chunk chunk;
+			const bool ok = readChunk(stream, c * chunkFaces, std::min(chunkFaces, stream.nfaces() - c * chunkFaces), threads, chunk);
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [&] { return ready.empty() || stopping; });
+			if (stopping) return;
+			if (!ok)
+			{
+				failed = true;
+				lock.unlock();
+				changed.notify_all();
+				return;
+			}
+			ready.push_back(std::move(chunk));
+			lock.unlock();
+			changed.notify_all();
+		}
+	});
+
+	const mat<4, 4> transform = view.transform();
+	const bool flat = shading.kind == ShaderKind::Flat;
+	Shading chunkShading = shading;
+	ScreenVertices screen;
+	bool ok = true;
+	for (std::uint64_t c = 0; c < nchunks; c++)
+	{
+		Chunk chunk;
+		{
+			ScopedTimer timer(Stage::StreamWait);
+			const auto start = std::chrono::steady_clock::now();
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [&] { return !ready.empty() || failed; });
+			streamStats.waitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (ready.empty())
+			{
+				ok = false;
+				break;
+			}
+			chunk = std::move(ready.front());
+			ready.pop_front();
+		}
+		changed.notify_all(); // The reader can go on with the chunk after next
+
+		const Model& model = *chunk.model;
+		transformVertices(model.positions(), transform, frameBuffer.width(), frameBuffer.height(), screen, threads, options.mode == RasterMode::Simd, options.subpixel ? subpixelBits : 0);
+		const std::vector<TGAColor> colors = flat ? randomFaceColors(model.nfaces()) : std::vector<TGAColor>();
+		chunkShading.colors = colors;
+		renderFaces(model, view, screen, chunkShading, zBuffer, frameBuffer, threads, options, stats);
+
+		streamStats.chunks++;
+		streamStats.vertices += model.nverts();
+		streamStats.peakChunkBytes = std::max(streamStats.peakChunkBytes, chunk.bytes);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	changed.notify_all();
+	reader.join();
+	streamStats.bytes += stream.bytes();
+	return ok;
+}
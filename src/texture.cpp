@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <cmath>
+#include <texture.h>
+
+namespace
+{
+	std::uint32_t pack(const TGAColor& c)
+	{
+		if (c.bytespp == 1) return 0xFF000000u | c.bgra[0] * 0x010101u; // Grayscale
+		const std::uint32_t alpha = c.bytespp == 4 ? c.bgra[3] : 255;
+		return c.bgra[0] | c.bgra[1] << 8 | c.bgra[2] << 16 | alpha << 24;
+	}
+
+	// Rounded channel-wise mean of four texels, the box filter between mip levels
+	std::uint32_t average(const std::uint32_t a, const std::uint32_t b, const std::uint32_t c, const std::uint32_t d)
+	{
+		constexpr std::uint32_t m = 0x00FF00FF, round = 0x00020002;
+		const std::uint32_t rb = (((a & m) + (b & m) + (c & m) + (d & m) + round) >> 2) & m;
+		const std::uint32_t ga = ((((a >> 8) & m) + ((b >> 8) & m) + ((c >> 8) & m) + ((d >> 8) & m) + round) >> 2) & m;
+		return rb | ga << 8;
+	}
+
+	int wrap(const int i, const int size)
+	{
+		const int r = i % size;
+		return r < 0 ? r + size : r;
+	}
+}
+
+Texture::Texture(const TGAImage& image)
+{
+	const int w = image.width(), h = image.height();
+	if (w <= 0 || h <= 0) return;
+
+	// Level sizes halve (rounding down) until both reach 1, each level padded to whole tiles
+	size_t total = 0;
+	for (int lw = w, lh = h;; lw = std::max(1, lw / 2), lh = std::max(1, lh / 2))
+	{
+		const int tilesX = (lw + tileSize - 1) / tileSize, tilesY = (lh + tileSize - 1) / tileSize;
+		levels.push_back({ lw, lh, tilesX, total });
+		total += static_cast<size_t>(tilesX) * tilesY * tileSize * tileSize;
+		if (lw == 1 && lh == 1) break;
+	}
+	texels.resize(total);
+
+	auto at = [&](const Level& level, const int x, const int y) -> std::uint32_t& { return texels[address(level, x, y)]; };
+
+	// Texel row 0 is the bottom of the picture, where v = 0. TGAImage rows count from the top.
+	for (int y = 0; y < h; y++)
+	{
+		for (int x = 0; x < w; x++) at(levels[0], x, y) = pack(image.get(x, h - 1 - y));
+	}
+
+	// Each level is the 2x2 box filtered one above it, odd rows and columns reuse the last texel
+	for (size_t l = 1; l < levels.size(); l++)
+	{
+		const Level& src = levels[l - 1];
+		const Level& dst = levels[l];
+		for (int y = 0; y < dst.height; y++)
+		{
+			const int y0 = std::min(2 * y, src.height - 1), y1 = std::min(2 * y + 1, src.height - 1);
+			for (int x = 0; x < dst.width; x++)
+			{
+				const int x0 = std::min(2 * x, src.width - 1), x1 = std::min(2 * x + 1, src.width - 1);
+				at(dst, x, y) = average(at(src, x0, y0), at(src, x1, y0), at(src, x0, y1), at(src, x1, y1));
+			}
+		}
+	}
+}
+
+bool Texture::load(const std::string& filename)
+{
+	TGAImage image;
+	if (!image.read_tga_file(filename)) return false;
+	*this = Texture(image);
+	return !empty();
+}
+
+TGAColor Texture::texel(const int level, const int x, const int y) const
+{
+	const Level& l = levels[std::clamp(level, 0, mipLevels() - 1)];
+	return Texture::unpack(texels[address(l, wrap(x, l.width), wrap(y, l.height))]);
+}
@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <tiler.h>
+
+
+TileBinner::TileBinner(const int width, const int height, const int tileSize)
+	: width(width), height(height), tileSize(tileSize),
+	  tilesX((width + tileSize - 1) / tileSize), tilesY((height + tileSize - 1) / tileSize)
+{
+	tiles.resize(tilesX * tilesY);
+	for (int ty = 0; ty < tilesY; ty++)
+	{
+		for (int tx = 0; tx < tilesX; tx++)
+		{
+			Tile& t = tiles[tx + ty * tilesX];
+			t.index = tx + ty * tilesX;
+			t.minx = tx * tileSize;
+			t.miny = ty * tileSize;
+			t.maxx = std::min(width - 1, t.minx + tileSize - 1);
+			t.maxy = std::min(height - 1, t.miny + tileSize - 1);
+		}
+	}
+}
+
+bool TileBinner::bin(const int tri, int minx, int miny, int maxx, int maxy)
+{
+	// Clamp to the screen first, triangles completely off-screen land in no tile
+	minx = std::max(minx, 0);
+	miny = std::max(miny, 0);
+	maxx = std::min(maxx, width - 1);
+	maxy = std::min(maxy, height - 1);
+	if (minx > maxx || miny > maxy) return false;
+
+	for (int ty = miny / tileSize; ty <= maxy / tileSize; ty++)
+	{
+		for (int tx = minx / tileSize; tx <= maxx / tileSize; tx++)
+		{
+			tiles[tx + ty * tilesX].tris.push_back(tri);
+		}
+	}
+	return true;
+}
+
+void TileBinner::clear()
+{
+	for (Tile& t : tiles) t.tris.clear();
+}
+
+int TileBinner::ntiles() const
+{
+	return static_cast<int>(tiles.size());
+}
+
+const Tile& TileBinner::tile(const int i) const
+{
+	return tiles.at(i);
+}
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <cmath>
+#include <vertexcache.h>
+
+namespace
+{
+	constexpr int cacheSize = 32; // LRU entries the scores model
+	constexpr int maxValence = 32; // Faces left on a vertex with a precomputed score, more get the last one
+
+	// Forsyth's vertex score: the three vertices of the last face score the same, so faces are not favoured by their
+	// own corner order, then the score decays with the cache position. A vertex with few faces left scores higher.
+	struct ScoreTables
+	{
+		float position[cacheSize] = {};
+		float valence[maxValence + 1] = {};
+
+		ScoreTables()
+		{
+			for (int i = 0; i < cacheSize; i++)
+			{
+				position[i] = i < 3 ? 0.75f : std::pow(1.0f - static_cast<float>(i - 3) / (cacheSize - 3), 1.5f);
+			}
+			for (int i = 1; i <= maxValence; i++) valence[i] = 2.0f / std::sqrt(static_cast<float>(i));
+		}
+
+		float score(const int cachePosition, const std::uint32_t remaining) const
+		{
+			if (remaining == 0) return -1; // Done with, its faces have all been emitted
+			return (cachePosition >= 0 ? position[cachePosition] : 0.0f) + valence[std::min<std::uint32_t>(remaining, maxValence)];
+		}
+	};
+}
+
+double acmr(std::span<const std::uint32_t> indices, const int nverts, const int cacheSize)
+{
+	if (indices.size() < 3) return 0;
+	// A vertex is in the FIFO while fewer than cacheSize misses happened since it was loaded
+	std::vector<std::uint64_t> loadedAt(nverts, 0);
+	std::uint64_t misses = 0;
+	for (const std::uint32_t v : indices)
+	{
+		if (loadedAt[v] == 0 || misses - loadedAt[v] >= static_cast<std::uint64_t>(cacheSize))
+		{
+			misses++;
+			loadedAt[v] = misses;
+		}
+	}
+	return static_cast<double>(misses) / static_cast<double>(indices.size() / 3);
+}
+
+std::vector<std::uint32_t> optimizeFaceOrder(std::span<const std::uint32_t> indices, const int nverts)
+{
+	static const ScoreTables tables;
+	const int nfaces = static_cast<int>(indices.size() / 3);
+
+	// Faces of every vertex, the first remaining[v] entries of its slice are the ones not emitted yet
+	std::vector<std::uint32_t> start(static_cast<size_t>(nverts) + 1, 0), remaining(nverts, 0);
+	for (const std::uint32_t v : indices) remaining[v]++;
+	for (int v = 0; v < nverts; v++) start[v + 1] = start[v] + remaining[v];
+	std::vector<std::uint32_t> faces(indices.size());
+	{
+		std::vector<std::uint32_t> next(start.begin(), start.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++) faces[next[indices[i]]++] = static_cast<std::uint32_t>(i / 3);
+	}
+
+	std::vector<int> position(nverts, -1);
+	std::vector<float> vertexScore(nverts);
+	for (int v = 0; v < nverts; v++) vertexScore[v] = tables.score(-1, remaining[v]);
+
+	std::vector<std::uint8_t> emitted(nfaces, 0);
+	std::vector<std::uint32_t> order;
+	order.reserve(nfaces);
+	std::uint32_t cache[cacheSize + 3];
+	int cached = 0;
+	int best = -1, cursor = 0;
+	while (static_cast<int>(order.size()) < nfaces)
+	{
+		if (best < 0) // Nothing in the cache has faces left, carry on with the next face in file order
+		{
+			while (emitted[cursor]) cursor++;
+			best = cursor;
+		}
+		emitted[best] = 1;
+		order.push_back(static_cast<std::uint32_t>(best));
+
+		// The face's vertices move to the front of the cache, the others shift back and the last ones fall out
+		std::uint32_t updated[cacheSize + 3];
+		int n = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			const std::uint32_t v = indices[best * 3 + k];
+			std::uint32_t* first = faces.data() + start[v];
+			*std::find(first, first + remaining[v], static_cast<std::uint32_t>(best)) = first[remaining[v] - 1];
+			remaining[v]--;
+			if (std::find(updated, updated + n, v) == updated + n) updated[n++] = v;
+		}
+		const int corners = n;
+		for (int i = 0; i < cached; i++)
+		{
+			if (std::find(updated, updated + corners, cache[i]) == updated + corners) updated[n++] = cache[i];
+		}
+
+		// Rescore the vertices that moved and their faces, the best of those goes next
+		for (int i = 0; i < n; i++)
+		{
+			const std::uint32_t v = updated[i];
+			position[v] = i < cacheSize ? i : -1;
+			vertexScore[v] = tables.score(position[v], remaining[v]);
+		}
+		best = -1;
+		float bestScore = -1;
+		for (int i = 0; i < n; i++)
+		{
+			const std::uint32_t v = updated[i];
+			for (std::uint32_t j = start[v]; j < start[v] + remaining[v]; j++)
+			{
+				const std::uint32_t f = faces[j];
+				const float score = vertexScore[indices[f * 3]] + vertexScore[indices[f * 3 + 1]] + vertexScore[indices[f * 3 + 2]];
+				if (score > bestScore)
+				{
+					bestScore = score;
+					best = static_cast<int>(f);
+				}
+			}
+		}
+		cached = std::min(n, cacheSize);
+		std::copy(updated, updated + cached, cache);
+	}
+	return order;
+}
+
+std::vector<std::uint32_t> vertexFetchOrder(std::span<const std::uint32_t> indices, const int nverts)
+{
+	constexpr std::uint32_t unused = 0xFFFFFFFF;
+	std::vector<std::uint32_t> remap(nverts, unused);
+	std::uint32_t next = 0;
+	for (const std::uint32_t v : indices)
+	{
+		if (remap[v] == unused) remap[v] = next++;
+	}
+	for (std::uint32_t& id : remap)
+	{
+		if (id == unused) id = next++;
+	}
+	return remap;
+}
@@ -0,0 +1,148 @@
+#include <cmath>
+#include <clipper.h>
+#include <parallel.h>
+#include <profiler.h>
+#include <vertexstage.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VERTEX_SSE2
+#endif
+
+namespace
+{
+	constexpr float coordinateLimit = 1 << 24;
+
+	// Written like _mm_max_ps/_mm_min_ps so NaNs (w == 0) end up at -limit in both paths
+	float clampCoordinate(const float v, const float limit)
+	{
+		float lo = v > -limit ? v : -limit;
+		return lo < limit ? lo : limit;
+	}
+
+	// `p` holds the positions of vertices begin to end
+	void transformScalar(const float* p, const mat4f& m, const float width, const float height, const int bits, const int begin, const int end, ScreenVertices& out)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			const float* v = p + (i - begin) * 3;
+			const vec4f h = toClip(m, v[0], v[1], v[2]);
+			const RasterVertex r = toRaster(h, bits);
+			out.x[i] = r.x;
+			out.y[i] = r.y;
+			out.z[i] = static_cast<float>(r.z);
+			out.rhw[i] = r.rhw;
+			out.clip[i] = outcode(h, width, height);
+		}
+	}
+
+#if defined(VERTEX_SSE2)
+	// Same math as transformScalar for 4 vertices at a time, the last partial group goes through the scalar loop
+	void transformSimd(const float* p, const mat4f& m, const float width, const float height, const int bits, const int begin, const int end, ScreenVertices& out)
+	{
+		__m128 row[4][4];
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++) row[r][c] = _mm_set1_ps(m[r][c]);
+		const __m128 scale = _mm_set1_ps(static_cast<float>(1 << bits));
+		const __m128 lo = _mm_set1_ps(-coordinateLimit * (1 << bits)), hi = _mm_set1_ps(coordinateLimit * (1 << bits));
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1), nearW = _mm_set1_ps(clipNearW), right = _mm_set1_ps(width), top = _mm_set1_ps(height);
+
+		int i = begin;
+		for (; i + 4 <= end; i += 4)
+		{
+			const float* v = p + (i - begin) * 3;
+			const __m128 x = _mm_setr_ps(v[0], v[3], v[6], v[9]); // AoS to SoA
+			const __m128 y = _mm_setr_ps(v[1], v[4], v[7], v[10]);
+			const __m128 z = _mm_setr_ps(v[2], v[5], v[8], v[11]);
+			__m128 t[4];
+			for (int r = 0; r < 4; r++)
+			{
+				t[r] = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(row[r][0], x), _mm_mul_ps(row[r][1], y)), _mm_mul_ps(row[r][2], z)), row[r][3]);
+			}
+			const __m128 sx = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_div_ps(t[0], t[3]), scale), lo), hi);
+			const __m128 sy = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_div_ps(t[1], t[3]), scale), lo), hi);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out.x.data() + i), bits ? _mm_cvtps_epi32(sx) : _mm_cvttps_epi32(sx)); // Fixed point rounds, pixels truncate
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out.y.data() + i), bits ? _mm_cvtps_epi32(sy) : _mm_cvttps_epi32(sy));
+			_mm_storeu_ps(out.z.data() + i, _mm_div_ps(t[2], t[3]));
+			_mm_storeu_ps(out.rhw.data() + i, _mm_div_ps(one, t[3]));
+
+			// Outcodes: one sign mask per plane, then spread into a byte per vertex
+			const int nearMask = _mm_movemask_ps(_mm_cmplt_ps(t[3], nearW));
+			const __m128 negw = _mm_sub_ps(zero, t[3]);
+			const int leftMask = _mm_movemask_ps(_mm_cmple_ps(t[0], negw)), rightMask = _mm_movemask_ps(_mm_cmpge_ps(t[0], _mm_mul_ps(right, t[3])));
+			const int bottomMask = _mm_movemask_ps(_mm_cmple_ps(t[1], negw)), topMask = _mm_movemask_ps(_mm_cmpge_ps(t[1], _mm_mul_ps(top, t[3])));
+			for (int k = 0; k < 4; k++)
+			{
+				out.clip[i + k] = static_cast<std::uint8_t>(((nearMask >> k) & 1) * ClipNear | ((leftMask >> k) & 1) * ClipLeft | ((rightMask >> k) & 1) * ClipRight
+					| ((bottomMask >> k) & 1) * ClipBottom | ((topMask >> k) & 1) * ClipTop);
+			}
+		}
+		transformScalar(p + (i - begin) * 3, m, width, height, bits, i, end, out);
+	}
+#endif
+}
+
+vec4f toClip(const mat4f& m, const float x, const float y, const float z)
+{
+	return {
+		m[0][0] * x + m[0][1] * y + m[0][2] * z + m[0][3],
+		m[1][0] * x + m[1][1] * y + m[1][2] * z + m[1][3],
+		m[2][0] * x + m[2][1] * y + m[2][2] * z + m[2][3],
+		m[3][0] * x + m[3][1] * y + m[3][2] * z + m[3][3] };
+}
+
+RasterVertex toRaster(const vec4f& p, const int subpixelBits)
+{
+	if (subpixelBits)
+	{
+		// Rounded to the nearest 1/16 pixel, std::nearbyint rounds half to even like _mm_cvtps_epi32
+		const float scale = static_cast<float>(1 << subpixelBits), limit = coordinateLimit * scale;
+		return { static_cast<int>(std::nearbyint(clampCoordinate(p.x / p.w * scale, limit))), static_cast<int>(std::nearbyint(clampCoordinate(p.y / p.w * scale, limit))), p.z / p.w, 1.0f / p.w };
+	}
+	return { static_cast<int>(clampCoordinate(p.x / p.w, coordinateLimit)), static_cast<int>(clampCoordinate(p.y / p.w, coordinateLimit)), p.z / p.w, 1.0f / p.w }; // Prespective divide
+}
+
+void transformVertices(std::span<const float> positions, const mat<4, 4>& viewportProjectionModelView, const int width, const int height, ScreenVertices& out, const unsigned threads, const bool simd, const int subpixelBits)
+{
+	transformVertices(PositionView{ positions }, viewportProjectionModelView, width, height, out, threads, simd, subpixelBits);
+}
+
+void transformVertices(const PositionView& positions, const mat<4, 4>& viewportProjectionModelView, const int width, const int height, ScreenVertices& out, const unsigned threads, const bool simd, const int subpixelBits)
+{
+	ScopedTimer timer(Stage::Transform);
+	const int nverts = static_cast<int>(positions.size());
+	out.x.resize(nverts);
+	out.y.resize(nverts);
+	out.z.resize(nverts);
+	out.rhw.resize(nverts);
+	out.clip.resize(nverts);
+
+	const mat4f m = tofloat(viewportProjectionModelView); // The matrix is built in double once, the per-vertex work runs in float
+	out.transform = m;
+	out.subpixelBits = subpixelBits;
+	const float w = static_cast<float>(width), h = static_cast<float>(height);
+
+	constexpr int chunk = 1 << 14; // Vertices per job, a multiple of the SIMD width
+	parallelFor((nverts + chunk - 1) / chunk, threads, [&](const int c)
+	{
+		ScopedTimer chunkTimer(Stage::Chunk);
+		const int begin = c * chunk, end = std::min(nverts, begin + chunk);
+		const float* p = positions.floats.data() + static_cast<size_t>(begin) * 3;
+		if (positions.format() == PositionFormat::Quantized16)
+		{
+			thread_local std::vector<float> decoded;
+			decoded.resize(static_cast<size_t>(chunk) * 3);
+			const std::uint16_t* q = positions.quantized.data() + static_cast<size_t>(begin) * 3;
+			for (int i = 0; i < (end - begin) * 3; i++) decoded[i] = positions.grid.decode(i % 3, q[i]);
+			p = decoded.data();
+		}
+#if defined(VERTEX_SSE2)
+		if (simd)
+		{
+			transformSimd(p, m, w, h, subpixelBits, begin, end, out);
+			return;
+		}
+#endif
+		transformScalar(p, m, w, h, subpixelBits, begin, end, out);
+	});
+}
@@ -0,0 +1,72 @@
+#include <bit>
+#include <cmath>
+#include <weld.h>
+
+namespace
+{
+	struct CellKey
+	{
+		std::int64_t c[3] = {};
+
+		bool operator==(const CellKey& other) const { return c[0] == other.c[0] && c[1] == other.c[1] && c[2] == other.c[2]; }
+	};
+
+	CellKey cellOf(const float* p, const float epsilon)
+	{
+		CellKey key;
+		for (int i = 0; i < 3; i++)
+		{
+			if (epsilon > 0)
+			{
+				// Clamped well inside int64 so far away or non-finite coordinates still get a cell
+				const double cell = std::floor(static_cast<double>(p[i]) / epsilon);
+				key.c[i] = static_cast<std::int64_t>(cell > -4e18 ? (cell < 4e18 ? cell : 4e18) : -4e18);
+			}
+			else
+			{
+				key.c[i] = std::bit_cast<std::uint32_t>(p[i] + 0.0f); // Adding 0 turns -0 into 0
+			}
+		}
+		return key;
+	}
+
+	std::uint64_t hashOf(const CellKey& key)
+	{
+		std::uint64_t h = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			h = (h ^ static_cast<std::uint64_t>(key.c[i])) * 0x9E3779B97F4A7C15ull;
+			h ^= h >> 29;
+		}
+		return h;
+	}
+}
+
+std::vector<std::uint32_t> weldVertices(std::vector<float>& positions, const float epsilon)
+{
+	const size_t nverts = positions.size() / 3;
+	std::vector<std::uint32_t> remap(nverts);
+
+	// Open addressing on the new vertex ids, a slot's key is recomputed from the kept position it holds
+	constexpr std::uint32_t empty = 0xFFFFFFFF;
+	size_t capacity = 16;
+	while (capacity < nverts * 2) capacity *= 2;
+	std::vector<std::uint32_t> slots(capacity, empty);
+
+	std::uint32_t kept = 0;
+	for (size_t v = 0; v < nverts; v++)
+	{
+		const CellKey key = cellOf(&positions[v * 3], epsilon);
+		size_t slot = hashOf(key) & (capacity - 1);
+		while (slots[slot] != empty && !(cellOf(&positions[slots[slot] * 3], epsilon) == key)) slot = (slot + 1) & (capacity - 1);
+		if (slots[slot] == empty)
+		{
+			slots[slot] = kept;
+			for (int i = 0; i < 3; i++) positions[kept * 3 + i] = positions[v * 3 + i]; // Kept ids never pass v, so this only moves positions down
+			kept++;
+		}
+		remap[v] = slots[slot];
+	}
+	positions.resize(static_cast<size_t>(kept) * 3);
+	return remap;
+}
@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <limits>
+#include <clipper.h>
+#include <parallel.h>
+#include <profiler.h>
+#include <renderer.h>
+#include <wireframe.h>
+
+namespace
+{
+	constexpr int bandRows = 16; // Rows per band of the multithreaded wireframe, one worker owns a band
+
+	// line()'s walk, rebuilt so any step can be reached directly: the segment is turned so its major axis runs
+	// along `m` from a to b with at most one minor step per pixel. Before plotting step k the minor coordinate
+	// has moved steps(k) times, which follows in closed form from line()'s error term staying in (-dx, dx].
+	struct Walk
+	{
+		bool steep = false; // Major axis is y, pixels are (minor, major)
+		int am = 0, an = 0; // Start, major and minor coordinate
+		std::int64_t dx = 0, ady = 0; // Major length and absolute minor length, ady <= dx
+		int sy = 1; // Direction of the minor steps
+
+		explicit Walk(const Segment& s)
+		{
+			int ax = s.ax, ay = s.ay, bx = s.bx, by = s.by;
+			steep = std::abs(ax - bx) < std::abs(ay - by);
+			if (steep)
+			{
+				std::swap(ax, ay);
+				std::swap(bx, by);
+			}
+			if (ax > bx)
+			{
+				std::swap(ax, bx);
+				std::swap(ay, by);
+			}
+			am = ax; an = ay;
+			dx = std::int64_t(bx) - ax;
+			ady = std::abs(std::int64_t(by) - ay);
+			sy = by > ay ? 1 : -1;
+		}
+
+		std::int64_t steps(const std::int64_t k) const { return dx ? (2 * ady * k + dx - 1) / (2 * dx) : 0; }
+
+		// First step k with steps(k) >= t, past the end when the segment never gets there
+		std::int64_t first(const std::int64_t t) const
+		{
+			if (t <= 0) return 0;
+			if (ady == 0) return dx + 1;
+			return (2 * dx * t - dx + 1 + 2 * ady - 1) / (2 * ady);
+		}
+
+		// Steps [k0, k1] whose pixel lies inside major range [mlo, mhi] and minor range [nlo, nhi], empty when k0 > k1
+		void clipAxes(const int mlo, const int mhi, const int nlo, const int nhi, std::int64_t& k0, std::int64_t& k1) const
+		{
+			k0 = std::max<std::int64_t>(0, std::int64_t(mlo) - am);
+			k1 = std::min<std::int64_t>(dx, std::int64_t(mhi) - am);
+			const std::int64_t below = sy > 0 ? std::int64_t(nlo) - an : std::int64_t(an) - nhi; // Minor steps needed to enter
+			const std::int64_t above = sy > 0 ? std::int64_t(nhi) - an : std::int64_t(an) - nlo; // and to leave, plus one
+			if (above < 0)
+			{
+				k1 = -1;
+				return;
+			}
+			k0 = std::max(k0, first(below));
+			k1 = std::min(k1, first(above + 1) - 1);
+		}
+
+		// Same for the pixel rectangle (inclusive bounds)
+		void clip(const int minx, const int miny, const int maxx, const int maxy, std::int64_t& k0, std::int64_t& k1) const
+		{
+			if (steep) clipAxes(miny, maxy, minx, maxx, k0, k1);
+			else clipAxes(minx, maxx, miny, maxy, k0, k1);
+		}
+	};
+
+	// Rows the visible steps [k0, k1] of the walk cover, lowest first
+	void rowRange(const Walk& walk, const std::int64_t k0, const std::int64_t k1, int& lo, int& hi)
+	{
+		if (walk.steep)
+		{
+			lo = static_cast<int>(walk.am + k0);
+			hi = static_cast<int>(walk.am + k1);
+			return;
+		}
+		const int a = static_cast<int>(walk.an + walk.sy * walk.steps(k0)), b = static_cast<int>(walk.an + walk.sy * walk.steps(k1));
+		lo = std::min(a, b);
+		hi = std::max(a, b);
+	}
+
+	// Items sorted into bands of rows by the rows they touch, an item spanning several bands is in each of them
+	struct Bands
+	{
+		std::vector<int> start = {}; // Items of band i are items[start[i]] .. items[start[i + 1] - 1]
+		std::vector<int> items = {};
+
+		// rows(i, lo, hi) gives the rows of item i, false for items to leave out
+		template<typename F> void build(const int count, const int nbands, F&& rows)
+		{
+			start.assign(nbands + 1, 0);
+			for (int i = 0; i < count; i++)
+			{
+				int lo, hi;
+				if (!rows(i, lo, hi)) continue;
+				for (int b = lo / bandRows; b <= hi / bandRows; b++) start[b + 1]++;
+			}
+			for (int b = 0; b < nbands; b++) start[b + 1] += start[b];
+			items.resize(start[nbands]);
+			std::vector<int> next(start.begin(), start.end() - 1);
+			for (int i = 0; i < count; i++)
+			{
+				int lo, hi;
+				if (!rows(i, lo, hi)) continue;
+				for (int b = lo / bandRows; b <= hi / bandRows; b++) items[next[b]++] = i;
+			}
+		}
+	};
+}
+
+EdgeList buildEdges(const IndexView& indices, const int nverts, const unsigned threads)
+{
+	ScopedTimer timer(Stage::Edges);
+	const size_t nfaces = indices.size() / 3;
+
+	// Bucket the face edges by their lower vertex (a counting sort), each vertex then only has a handful to dedupe
+	std::vector<std::uint32_t> start(static_cast<size_t>(nverts) + 1, 0);
+	for (size_t f = 0; f < nfaces; f++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			const std::uint32_t a = indices[f * 3 + k], b = indices[f * 3 + (k + 1) % 3];
+			if (a != b) start[std::min(a, b) + 1]++;
+		}
+	}
+	for (int v = 0; v < nverts; v++) start[v + 1] += start[v];
+	std::vector<std::uint32_t> others(start[nverts]);
+	std::vector<std::uint32_t> next(start.begin(), start.end() - 1);
+	for (size_t f = 0; f < nfaces; f++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			const std::uint32_t a = indices[f * 3 + k], b = indices[f * 3 + (k + 1) % 3];
+			if (a != b) others[next[std::min(a, b)]++] = std::max(a, b);
+		}
+	}
+
+	// Sort and dedupe every bucket in place, `next` becomes the end of its unique part
+	constexpr int chunk = 1 << 14;
+	parallelFor((nverts + chunk - 1) / chunk, threads, [&](const int c)
+	{
+		const int end = std::min(nverts, (c + 1) * chunk);
+		for (int v = c * chunk; v < end; v++)
+		{
+			std::sort(others.begin() + start[v], others.begin() + start[v + 1]);
+			next[v] = static_cast<std::uint32_t>(std::unique(others.begin() + start[v], others.begin() + start[v + 1]) - others.begin());
+		}
+	});
+
+	EdgeList edges;
+	size_t total = 0;
+	for (int v = 0; v < nverts; v++) total += next[v] - start[v];
+	edges.from.reserve(total);
+	edges.to.reserve(total);
+	for (int v = 0; v < nverts; v++)
+	{
+		for (std::uint32_t i = start[v]; i < next[v]; i++)
+		{
+			edges.from.push_back(static_cast<std::uint32_t>(v));
+			edges.to.push_back(others[i]);
+		}
+	}
+	return edges;
+}
+
+int drawSegment(const Segment& s, const int minx, const int miny, const int maxx, const int maxy, FrameBuffer& frameBuffer, const std::uint32_t color)
+{
+	const Walk walk(s);
+	std::int64_t k0, k1;
+	walk.clip(minx, miny, maxx, maxy, k0, k1);
+	if (k0 > k1) return 0;
+
+	// line()'s loop from step k0 on, with the error term it would have there
+	const std::int64_t stepped = walk.steps(k0);
+	int n = static_cast<int>(walk.an + walk.sy * stepped);
+	std::int64_t error = 2 * walk.ady * k0 - 2 * walk.dx * stepped;
+	const int m0 = static_cast<int>(walk.am + k0), m1 = static_cast<int>(walk.am + k1);
+	if (walk.steep)
+	{
+		for (int m = m0; m <= m1; m++)
+		{
+			frameBuffer.set(n, m, color);
+			error += 2 * walk.ady;
+			if (error > walk.dx)
+			{
+				n += walk.sy;
+				error -= 2 * walk.dx;
+			}
+		}
+	}
+	else
+	{
+		int run = m0; // First pixel of the current row's span
+		for (int m = m0; m <= m1; m++)
+		{
+			error += 2 * walk.ady;
+			if (error > walk.dx)
+			{
+				frameBuffer.fill(run, m, n, color);
+				run = m + 1;
+				n += walk.sy;
+				error -= 2 * walk.dx;
+			}
+		}
+		if (run <= m1) frameBuffer.fill(run, m1, n, color);
+	}
+	return m1 - m0 + 1;
+}
+
+void renderWireframe(const Model& model, const EdgeList& edges, const ScreenVertices& screen, FrameBuffer& frameBuffer, const unsigned threads)
+{
+	ScopedTimer timer(Stage::Lines);
+	const int w = frameBuffer.width(), h = frameBuffer.height();
+	const PositionView p = model.positions();
+
+	// Whole pixel segments of the edges that can reach the screen, and the rows they draw on. Both ends outside one
+	// clip plane puts every pixel of the edge there, the near plane included; edges crossing the near plane are cut at it.
+	struct Placed
+	{
+		Segment segment;
+		int lo = 0, hi = -1; // Rows with pixels of the segment, none when hi < lo
+	};
+	std::vector<Placed> placed(edges.size());
+	std::atomic<std::uint64_t> lines = 0;
+	constexpr int chunk = 4096;
+	parallelFor((edges.size() + chunk - 1) / chunk, threads, [&](const int c)
+	{
+		const int end = std::min(edges.size(), (c + 1) * chunk);
+		std::uint64_t visible = 0;
+		for (int i = c * chunk; i < end; i++)
+		{
+			const std::uint32_t u = edges.from[i], v = edges.to[i];
+			if (screen.clip[u] & screen.clip[v]) continue;
+			Segment& segment = placed[i].segment;
+			if ((screen.clip[u] | screen.clip[v]) & ClipNear)
+			{
+				const vec3f pu = p[u], pv = p[v];
+				vec4f hu = toClip(screen.transform, pu.x, pu.y, pu.z), hv = toClip(screen.transform, pv.x, pv.y, pv.z);
+				if (!clipNear(hu, hv)) continue;
+				const RasterVertex a = toRaster(hu), b = toRaster(hv);
+				segment = { a.x, a.y, b.x, b.y };
+			}
+			else
+			{
+				const int bits = screen.subpixelBits; // Lines are drawn between whole pixels
+				segment = { screen.x[u] >> bits, screen.y[u] >> bits, screen.x[v] >> bits, screen.y[v] >> bits };
+			}
+			const Walk walk(segment);
+			std::int64_t k0, k1;
+			walk.clip(0, 0, w - 1, h - 1, k0, k1);
+			if (k0 > k1) continue;
+			rowRange(walk, k0, k1, placed[i].lo, placed[i].hi);
+			visible++;
+		}
+		lines += visible;
+	});
+
+	const std::uint32_t edgeColor = FrameBuffer::pack(red), dotColor = FrameBuffer::pack(white);
+	auto onScreen = [&](const int i) // Vertex dot i, behind the camera the divide would mirror it onto the screen
+	{
+		if (screen.clip[i] & ClipNear) return false;
+		const int x = screen.x[i] >> screen.subpixelBits, y = screen.y[i] >> screen.subpixelBits;
+		return x >= 0 && y >= 0 && x < w && y < h;
+	};
+	std::atomic<std::uint64_t> pixels = 0;
+
+	if (threads <= 1)
+	{
+		std::uint64_t plotted = 0;
+		for (const Placed& e : placed)
+		{
+			if (e.lo <= e.hi) plotted += drawSegment(e.segment, 0, 0, w - 1, h - 1, frameBuffer, edgeColor);
+		}
+		pixels = plotted;
+		for (int i = 0; i < screen.size(); i++)
+		{
+			if (onScreen(i)) frameBuffer.set(screen.x[i] >> screen.subpixelBits, screen.y[i] >> screen.subpixelBits, dotColor);
+		}
+	}
+	else
+	{
+		// Bin segments and dots into bands of rows, then every worker draws whole bands clipped to their rows:
+		// all edges first and the dots on top, like the single-threaded order
+		const int nbands = (h + bandRows - 1) / bandRows;
+		Bands segmentBands, dotBands;
+		{
+			ScopedTimer binTimer(Stage::Bin);
+			segmentBands.build(edges.size(), nbands, [&](const int i, int& lo, int& hi)
+			{
+				lo = placed[i].lo;
+				hi = placed[i].hi;
+				return lo <= hi;
+			});
+			dotBands.build(screen.size(), nbands, [&](const int i, int& lo, int& hi)
+			{
+				if (!onScreen(i)) return false;
+				lo = hi = screen.y[i] >> screen.subpixelBits;
+				return true;
+			});
+		}
+		parallelFor(nbands, threads, [&](const int b)
+		{
+			const int miny = b * bandRows, maxy = std::min(h, miny + bandRows) - 1;
+			std::uint64_t plotted = 0;
+			for (int j = segmentBands.start[b]; j < segmentBands.start[b + 1]; j++)
+			{
+				plotted += drawSegment(placed[segmentBands.items[j]].segment, 0, miny, w - 1, maxy, frameBuffer, edgeColor);
+			}
+			for (int j = dotBands.start[b]; j < dotBands.start[b + 1]; j++)
+			{
+				const int i = dotBands.items[j];
+				frameBuffer.set(screen.x[i] >> screen.subpixelBits, screen.y[i] >> screen.subpixelBits, dotColor);
+			}
+			pixels += plotted;
+		});
+	}
+	addCount(Counter::TrianglesSubmitted, model.nfaces());
+	addCount(Counter::Lines, lines);
+	addCount(Counter::LinePixels, pixels);
+}
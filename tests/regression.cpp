@@ -0,0 +1,194 @@
+// Regression checks for the software renderer, run through ctest or directly as bin/regression.
+//
+// Each check renders or loads a small generated mesh and compares against what the code promises (the same image
+// from every thread count, a cache that is reused...). A failing check prints why and the run exits non-zero.
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <numbers>
+#include <string>
+#include <vector>
+#include <meshcache.h>
+#include <renderer.h>
+#include <streaming.h>
+
+namespace
+{
+	constexpr int width = 256;
+	constexpr int height = 256;
+
+	// Keeps the loader's log lines out of the check output
+	class QuietLog
+	{
+		std::streambuf* saved = std::cerr.rdbuf(nullptr);
+
+	public:
+		~QuietLog() { std::cerr.rdbuf(saved); }
+	};
+
+	// A UV sphere of radius 0.8 around the origin, counter-clockwise seen from outside, as OBJ text. Every face line goes
+	// through faceLine(face, a, b, c) with 1-based vertex ids, so checks can vary how the faces are written.
+	std::string sphereObj(const int rings, const std::function<std::string(int, int, int, int)>& faceLine)
+	{
+		const int segments = 2 * rings;
+		std::string obj;
+		for (int r = 0; r <= rings; r++)
+		{
+			const double theta = std::numbers::pi * r / rings;
+			for (int s = 0; s < segments; s++)
+			{
+				const double phi = 2 * std::numbers::pi * s / segments;
+				obj += "v " + std::to_string(0.8 * std::sin(theta) * std::cos(phi)) + ' ' + std::to_string(0.8 * std::cos(theta)) + ' '
+					+ std::to_string(0.8 * std::sin(theta) * std::sin(phi)) + '\n';
+			}
+		}
+		int face = 0;
+		for (int r = 0; r < rings; r++)
+		{
+			for (int s = 0; s < segments; s++)
+			{
+				const int a = r * segments + s + 1, b = r * segments + (s + 1) % segments + 1, c = a + segments, d = b + segments;
+				obj += faceLine(face++, a, b, c);
+				obj += faceLine(face++, b, d, c);
+			}
+		}
+		return obj;
+	}
+
+	std::string plainFace(const int, const int a, const int b, const int c)
+	{
+		return "f " + std::to_string(a) + ' ' + std::to_string(b) + ' ' + std::to_string(c) + '\n';
+	}
+
+	// A fresh OBJ file in the temp directory, removed with its mesh cache when the check is done
+	struct TempObj
+	{
+		std::string path;
+
+		TempObj(const std::string& name, const std::string& text) : path((std::filesystem::temp_directory_path() / name).string())
+		{
+			std::ofstream(path, std::ios::binary) << text;
+			std::filesystem::remove(meshCachePath(path));
+		}
+		~TempObj()
+		{
+			std::filesystem::remove(path);
+			std::filesystem::remove(meshCachePath(path));
+		}
+	};
+
+	// --faces with flat colors, the way main() draws them
+	FrameBuffer render(const Model& model, const unsigned threads, RasterStats& stats)
+	{
+		const View view = makeView(Camera(), width, height);
+		ScreenVertices screen;
+		transformVertices(model.positions(), view.transform(), width, height, screen, threads);
+		srand(1);
+		const std::vector<TGAColor> colors = randomFaceColors(model.nfaces());
+		Shading shading;
+		shading.colors = colors;
+		DepthBuffer zBuffer(width, height);
+		FrameBuffer frameBuffer(width, height);
+		renderFaces(model, view, screen, shading, zBuffer, frameBuffer, threads, {}, stats);
+		return frameBuffer;
+	}
+
+	bool samePixels(const FrameBuffer& a, const FrameBuffer& b)
+	{
+		for (int y = 0; y < height; y++)
+		{
+			if (!std::equal(a.row(y), a.row(y) + width, b.row(y))) return false;
+		}
+		return true;
+	}
+
+	// A file with a quad halfway through keeps the faces before it. Both renderers have to draw them (user-001).
+	bool partialLoadSameOnEveryThreadCount()
+	{
+		std::string obj = sphereObj(20, plainFace);
+		const size_t faces = obj.find("f ");
+		obj.insert(obj.find("f ", faces + (obj.size() - faces) / 2), "f 1 2 3 4\n");
+		const TempObj file("opengldemo_regression_partial.obj", obj);
+		QuietLog quiet;
+		ModelLoadOptions options;
+		options.cache = false;
+		const Model model(file.path, options);
+		RasterStats serialStats, tiledStats;
+		const FrameBuffer serial = render(model, 1, serialStats), tiled = render(model, 4, tiledStats);
+		return model.nfaces() > 0 && serialStats.pixelsWritten > 0 && samePixels(serial, tiled);
+	}
+
+	// f v/vt/vn in a file without vt or vn records: the faces have neither, the mesh cache is written consistently and
+	// reused on the next load, and --stream draws it like the in-core renderer (user-019)
+	bool danglingAttributesRoundTripThroughTheCache()
+	{
+		const TempObj file("opengldemo_regression_attributes.obj", sphereObj(20, [](const int face, const int a, const int b, const int c)
+		{
+			const std::string n = std::to_string(face + 1);
+			return "f " + std::to_string(a) + '/' + n + '/' + n + ' ' + std::to_string(b) + '/' + n + '/' + n + ' ' + std::to_string(c) + '/' + n + '/' + n + '\n';
+		}));
+		QuietLog quiet;
+		{
+			const Model parsed(file.path); // Writes the cache
+			if (parsed.hasUVs() || parsed.hasNormals()) return false;
+		}
+		MeshCacheArrays arrays;
+		if (!openMeshCache(file.path, arrays) || !arrays.uvIndices.empty() || !arrays.normalIndices.empty()) return false;
+
+		const Model model(file.path);
+		RasterStats stats, streamedStats;
+		const FrameBuffer inCore = render(model, 1, stats);
+		const View view = makeView(Camera(), width, height);
+		srand(1);
+		DepthBuffer zBuffer(width, height);
+		FrameBuffer streamed(width, height);
+		StreamOptions streamOptions;
+		streamOptions.chunkFaces = 500;
+		StreamStats streamStats;
+		return renderStreamed(file.path, view, {}, zBuffer, streamed, 1, {}, streamOptions, streamedStats, streamStats) && stats.pixelsWritten > 0
+			&& samePixels(inCore, streamed);
+	}
+
+	// A cache whose vertex index was overwritten in place still passes the size checks, --verify-cache has to catch it (user-007)
+	bool verifyCacheRejectsOutOfRangeIndices()
+	{
+		const TempObj file("opengldemo_regression_verify.obj", sphereObj(20, plainFace));
+		QuietLog quiet;
+		{
+			const Model parsed(file.path); // Writes the cache
+		}
+		MeshCacheArrays arrays;
+		if (!openMeshCache(file.path, arrays, true)) return false;
+
+		MeshCacheHeader header;
+		std::fstream cache(meshCachePath(file.path), std::ios::in | std::ios::out | std::ios::binary);
+		cache.read(reinterpret_cast<char*>(&header), sizeof(header));
+		const std::uint64_t positionBytes = header.nverts * 3 * (header.positionFormat == static_cast<std::uint32_t>(PositionFormat::Quantized16) ? 2 : 4);
+		const char outOfRange[4] = { '\xFF', '\xFF', '\xFF', '\xFF' };
+		cache.seekp(static_cast<std::streamoff>(sizeof(header) + (positionBytes + 3) / 4 * 4));
+		cache.write(outOfRange, header.indexFormat == static_cast<std::uint32_t>(IndexFormat::UInt16) ? 2 : 4);
+		cache.close();
+		return !openMeshCache(file.path, arrays, true);
+	}
+}
+
+int main()
+{
+	const std::pair<const char*, bool (*)()> checks[] = {
+		{ "partial_load_same_on_every_thread_count", partialLoadSameOnEveryThreadCount },
+		{ "dangling_attributes_round_trip_through_the_cache", danglingAttributesRoundTripThroughTheCache },
+		{ "verify_cache_rejects_out_of_range_indices", verifyCacheRejectsOutOfRangeIndices },
+	};
+	int failed = 0;
+	for (const auto& [name, check] : checks)
+	{
+		const bool ok = check();
+		std::cout << (ok ? "ok   " : "FAIL ") << name << "\n";
+		failed += !ok;
+	}
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}